@@ -0,0 +1,13 @@
+# Benchmarks de los núcleos, del enmascaramiento, de la lectura de archivos y de la reconstrucción (benchmark.cpp), sin Qt
+QT -= core gui
+CONFIG -= qt app_bundle
+CONFIG += console c++20 thread release
+TARGET = Benchmark
+
+include(Reconstruccion.pri)
+
+SOURCES += benchmark.cpp \
+    archivos.cpp \
+    imagenes.cpp
+HEADERS += archivos.h \
+    imagenes.h
@@ -0,0 +1,14 @@
+# Generador de casos sintéticos (generador.cpp): escribe I_O, I_D, I_M, M y M0 ... MN sin Qt
+QT -= core gui
+CONFIG -= qt app_bundle
+CONFIG += console c++20 thread
+TARGET = Generador
+
+# archivos.cpp calcula las preimágenes con calcularObjetivos de la biblioteca
+include(Reconstruccion.pri)
+
+SOURCES += generador.cpp \
+    archivos.cpp \
+    imagenes.cpp
+HEADERS += archivos.h \
+    imagenes.h
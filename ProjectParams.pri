@@ -0,0 +1,15 @@
+# Fuentes comunes a la compilación con Qt (ProjectParams.pro) y sin Qt (ProjectParamsHeadless.pro)
+include($$PWD/Reconstruccion.pri)
+
+SOURCES += $$PWD/main.cpp \
+    $$PWD/archivos.cpp \
+    $$PWD/imagenes.cpp \
+    $$PWD/metricas.cpp \
+    $$PWD/servidor.cpp
+HEADERS += $$PWD/archivos.h \
+    $$PWD/imagenes.h \
+    $$PWD/metricas.h \
+    $$PWD/servidor.h
+
+# GetProcessMemoryInfo (pico de memoria en metricas.cpp)
+win32: LIBS += -lpsapi
@@ -1,3 +1,3 @@
 QT += core gui
-CONFIG += console c++17
-SOURCES += main.cpp
+CONFIG += console c++20
+include(ProjectParams.pri)
@@ -0,0 +1,7 @@
+# Compilación sin Qt para servidores sin entorno gráfico: las imágenes se leen y escriben con imagenes.cpp
+QT -= core gui
+CONFIG -= qt app_bundle
+CONFIG += console c++20 thread
+DEFINES += SIN_QT
+TARGET = ProjectParamsHeadless
+include(ProjectParams.pri)
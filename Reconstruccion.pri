@@ -0,0 +1,11 @@
+# Fuentes de la biblioteca de reconstrucción (sin Qt y sin acceso a archivos), comunes al programa y a Reconstruccion.pro
+SOURCES += $$PWD/busqueda.cpp \
+    $$PWD/memoria.cpp \
+    $$PWD/operaciones.cpp \
+    $$PWD/paralelo.cpp \
+    $$PWD/reconstruccion.cpp
+HEADERS += $$PWD/busqueda.h \
+    $$PWD/memoria.h \
+    $$PWD/operaciones.h \
+    $$PWD/paralelo.h \
+    $$PWD/reconstruccion.h
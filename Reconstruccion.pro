@@ -0,0 +1,7 @@
+# Biblioteca estática con la reconstrucción sobre buffers (reconstruccion.h), para enlazarla desde otros programas
+TEMPLATE = lib
+QT -= core gui
+CONFIG -= qt
+CONFIG += staticlib c++20 thread
+TARGET = Reconstruccion
+include(Reconstruccion.pri)
@@ -0,0 +1,705 @@
+#include "archivos.h"
+#include "operaciones.h"
+#include "reconstruccion.h"
+
+#include <bit>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+
+/* ************************************************** Archivos proyectados en memoria *********************************************************** */
+
+ArchivoMapeado::~ArchivoMapeado(){
+
+    cerrar();
+
+}
+
+bool ArchivoMapeado::abrir(const char* ruta){
+
+    cerrar();
+
+#ifdef _WIN32
+
+    HANDLE manejador = CreateFileA(ruta, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (manejador == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER tam;
+
+    if (!GetFileSizeEx(manejador, &tam)) {
+        CloseHandle(manejador);
+        return false;
+    }
+
+    archivo = manejador;
+    bytes = (size_t)tam.QuadPart;
+
+    // Un archivo vacío no se puede proyectar, pero es válido
+    if (bytes == 0) {
+        return true;
+    }
+
+    proyeccion = CreateFileMappingA(manejador, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (proyeccion == nullptr) {
+        cerrar();
+        return false;
+    }
+
+    inicio = (const unsigned char*)MapViewOfFile(proyeccion, FILE_MAP_READ, 0, 0, 0);
+
+    if (inicio == nullptr) {
+        cerrar();
+        return false;
+    }
+
+#else
+
+    int descriptor = open(ruta, O_RDONLY);
+
+    if (descriptor < 0) {
+        return false;
+    }
+
+    struct stat informacion;
+
+    if (fstat(descriptor, &informacion) != 0) {
+        close(descriptor);
+        return false;
+    }
+
+    bytes = (size_t)informacion.st_size;
+
+    if (bytes > 0) {
+
+        void* proyeccion = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+        if (proyeccion == MAP_FAILED) {
+            close(descriptor);
+            bytes = 0;
+            return false;
+        }
+
+        // El archivo se recorre de principio a fin
+        madvise(proyeccion, bytes, MADV_SEQUENTIAL);
+
+        inicio = (const unsigned char*)proyeccion;
+
+    }
+
+    // La proyección sigue siendo válida después de cerrar el descriptor
+    close(descriptor);
+
+#endif
+
+    return true;
+
+}
+
+void ArchivoMapeado::cerrar(){
+
+#ifdef _WIN32
+
+    if (inicio != nullptr) UnmapViewOfFile(inicio);
+    if (proyeccion != nullptr) CloseHandle(proyeccion);
+    if (archivo != nullptr) CloseHandle(archivo);
+
+    proyeccion = nullptr;
+    archivo = nullptr;
+
+#else
+
+    if (inicio != nullptr) munmap((void*)inicio, bytes);
+
+#endif
+
+    inicio = nullptr;
+    bytes = 0;
+
+}
+
+
+/* ************************************************** Archivos de enmascaramiento *********************************************************** */
+
+bool leerEnmascaramiento(const char* ruta, DatosEnmascaramiento& datos, string& error){
+    /*
+ * @brief Carga la semilla y las sumas del enmascaramiento recorriendo el archivo una sola vez.
+ *
+ * El archivo se proyecta en memoria y cada línea se convierte con std::from_chars, sin locales ni flujos.
+ * La primera línea con datos es la semilla y cada una de las siguientes debe tener tres sumas entre 0 y 510.
+ * El vector de sumas crece a medida que se leen las líneas, sin contar antes cuántas hay.
+ *
+ * @param ruta Ruta del archivo .txt.
+ * @param datos Semilla y sumas leídas (R, G, B, R, G, B, ...).
+ * @param error Mensaje con el número de línea si el archivo está mal formado.
+ *
+ * @return true si el archivo se leyó completo; false si no se pudo abrir o tiene una línea mal formada.
+ */
+
+    datos.semilla = 0;
+    datos.sumas.clear();
+
+    ArchivoMapeado archivo;
+
+    if (!archivo.abrir(ruta)) {
+        error = string("No se pudo abrir el archivo ") + ruta;
+        return false;
+    }
+
+    return leerEnmascaramientoTexto((const char*)archivo.datos(), archivo.tamano(), ruta, datos, error);
+
+}
+
+bool leerEnmascaramientoTexto(const char* texto, size_t tam, const char* ruta, DatosEnmascaramiento& datos, string& error){
+    /*
+ * @brief Convierte el contenido de un archivo de enmascaramiento de texto que ya está en memoria.
+ *
+ * @param texto Contenido del archivo (no necesita terminar en '\0').
+ * @param tam Bytes del contenido.
+ * @param ruta Nombre que se usa en los mensajes de error.
+ */
+
+    datos.semilla = 0;
+    datos.sumas.clear();
+
+    const char* p = texto;
+    const char* fin = p + tam;
+
+    // Cada línea "rrr ggg bbb\n" ocupa unos 12 bytes; el vector crece si hace falta
+    datos.sumas.reserve(tam / 4);
+
+    long long linea = 0;
+    bool haySemilla = false;
+
+    while (p < fin) {
+
+        linea++;
+
+        const char* finLinea = (const char*)memchr(p, '\n', fin - p);
+
+        if (finLinea == nullptr) {
+            finLinea = fin;
+        }
+
+        long long valores[3];
+        int cantidad = 0;
+
+        const char* q = p;
+
+        while (true) {
+
+            while (q < finLinea && (*q == ' ' || *q == '\t' || *q == '\r')) q++;
+
+            if (q == finLinea) {
+                break;
+            }
+
+            if (cantidad == 3) {
+                error = string(ruta) + ", linea " + to_string(linea) + ": hay mas de tres valores";
+                return false;
+            }
+
+            from_chars_result leido = from_chars(q, finLinea, valores[cantidad]);
+
+            if (leido.ec != errc() || (leido.ptr < finLinea && *leido.ptr != ' ' && *leido.ptr != '\t' && *leido.ptr != '\r')) {
+                error = string(ruta) + ", linea " + to_string(linea) + ": valor no numerico";
+                return false;
+            }
+
+            q = leido.ptr;
+            cantidad++;
+
+        }
+
+        p = (finLinea < fin) ? finLinea + 1 : fin;
+
+        // Las líneas vacías (por ejemplo al final del archivo) se ignoran
+        if (cantidad == 0) {
+            continue;
+        }
+
+        if (!haySemilla) {
+
+            if (cantidad != 1) {
+                error = string(ruta) + ", linea " + to_string(linea) + ": se esperaba solo la semilla";
+                return false;
+            }
+
+            datos.semilla = valores[0];
+            haySemilla = true;
+            continue;
+
+        }
+
+        if (cantidad != 3) {
+            error = string(ruta) + ", linea " + to_string(linea) + ": se esperaban tres valores";
+            return false;
+        }
+
+        for (int c = 0; c < 3; c++) {
+
+            if (valores[c] < 0 || valores[c] > 510) {
+                error = string(ruta) + ", linea " + to_string(linea) + ": la suma " + to_string(valores[c]) + " esta fuera de 0..510";
+                return false;
+            }
+
+            datos.sumas.push_back((uint16_t)valores[c]);
+
+        }
+
+    }
+
+    if (!haySemilla) {
+        error = string(ruta) + ": el archivo esta vacio";
+        return false;
+    }
+
+    return true;
+
+}
+
+
+/* ************************************************** Formato binario *********************************************************** */
+
+uint64_t hashFnv1a(const void* datos, size_t bytes, uint64_t hash){
+
+    const unsigned char* p = (const unsigned char*)datos;
+
+    for (size_t i = 0; i < bytes; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+
+}
+
+bool existeArchivo(const string& ruta){
+
+    FILE* archivo = fopen(ruta.c_str(), "rb");
+
+    if (archivo == nullptr) {
+        return false;
+    }
+
+    fclose(archivo);
+
+    return true;
+
+}
+
+string rutaEnmascaramiento(const char* rutaTexto){
+
+    // Si junto a M*.txt hay un M*.bin (generado con --convert-masking) se prefiere el binario, pero solo si no es
+    // más antiguo que el texto: un .txt regenerado después (p. ej. con Generador sin --binary en el mismo
+    // directorio) deja al .bin desactualizado, y un .bin de sumas no tiene nada con qué compararse
+    string ruta = rutaTexto;
+    size_t punto = ruta.rfind('.');
+    string binario = ruta.substr(0, punto) + ".bin";
+
+    error_code errorBinario;
+    error_code errorTexto;
+    filesystem::file_time_type fechaBinario = filesystem::last_write_time(binario, errorBinario);
+    filesystem::file_time_type fechaTexto = filesystem::last_write_time(ruta, errorTexto);
+
+    if (errorBinario) {
+        return ruta;
+    }
+
+    return (errorTexto || fechaBinario >= fechaTexto) ? binario : ruta;
+
+}
+
+bool abrirEnmascaramiento(const char* ruta, FuenteEnmascaramiento& fuente, string& error){
+    /*
+ * @brief Abre un archivo de enmascaramiento en formato de texto o binario.
+ *
+ * El formato se reconoce por la firma de los primeros bytes. Un archivo binario queda proyectado en memoria y la
+ * vista apunta directamente a sus valores, sin copiarlos; solo se recorren una vez para comprobar la suma de
+ * verificación. Un archivo de texto se lee con leerEnmascaramiento.
+ *
+ * @param ruta Ruta del archivo (.txt o .bin).
+ * @param fuente Recibe los datos; la vista es válida mientras la fuente exista.
+ * @param error Mensaje si el archivo no se pudo abrir o está dañado.
+ */
+
+    fuente.binario.cerrar();
+
+    if (!fuente.binario.abrir(ruta)) {
+        fuente.vista = VistaEnmascaramiento();
+        error = string("No se pudo abrir el archivo ") + ruta;
+        return false;
+    }
+
+    bool abierto = abrirEnmascaramientoMemoria(fuente.binario.datos(), fuente.binario.tamano(), ruta, fuente, error);
+
+    // Un archivo de texto ya quedó convertido en fuente.texto: la proyección no se necesita más (un binario de
+    // preimágenes no tiene sumas, así que no se compara solo el puntero, que sería nullptr en ambos lados)
+    if (!abierto || (fuente.vista.sumas != nullptr && fuente.vista.sumas == fuente.texto.sumas.data())) {
+        fuente.binario.cerrar();
+    }
+
+    return abierto;
+
+}
+
+bool abrirEnmascaramientoMemoria(const unsigned char* datos, size_t tam, const char* ruta, FuenteEnmascaramiento& fuente, string& error){
+    /*
+ * @brief Igual que abrirEnmascaramiento, pero sobre el contenido de un archivo que ya está en memoria.
+ *
+ * Con el formato binario la vista apunta a 'datos', que debe seguir existiendo (y alineado a 2 bytes) mientras
+ * se use la fuente; con el formato de texto las sumas se copian a fuente.texto.
+ *
+ * @param ruta Nombre que se usa en los mensajes de error.
+ */
+
+    fuente.vista = VistaEnmascaramiento();
+    fuente.texto = DatosEnmascaramiento();
+    fuente.bytes = tam;
+
+    // Sin la firma se trata como texto
+    if (tam < sizeof(CabeceraEnmascaramiento) || memcmp(datos, MAGIA_ENMASCARAMIENTO, 4) != 0) {
+
+        if (!leerEnmascaramientoTexto((const char*)datos, tam, ruta, fuente.texto, error)) {
+            return false;
+        }
+
+        fuente.vista.semilla = fuente.texto.semilla;
+        fuente.vista.valores = fuente.texto.sumas.size();
+        fuente.vista.sumas = fuente.texto.sumas.data();
+
+        return true;
+
+    }
+
+    // La cabecera y las sumas se leen tal como están en el archivo (little-endian)
+    if constexpr (endian::native != endian::little) {
+        error = string(ruta) + ": el formato binario solo se puede leer en procesadores little-endian (use el .txt)";
+        return false;
+    }
+
+    CabeceraEnmascaramiento cabecera;
+    memcpy(&cabecera, datos, sizeof(cabecera));
+
+    size_t bytesValor = (cabecera.tipo == ENMASCARAMIENTO_PREIMAGENES) ? 1 : 2;
+
+    if (cabecera.version != VERSION_ENMASCARAMIENTO || cabecera.tipo > ENMASCARAMIENTO_PREIMAGENES) {
+        error = string(ruta) + ": version o tipo de formato binario no soportado";
+        return false;
+    }
+
+    if (cabecera.valores != (uint64_t)cabecera.anchoMascara * cabecera.altoMascara * 3 || cabecera.valores > (tam - sizeof(cabecera)) / bytesValor) {
+        error = string(ruta) + ": el tamano del archivo no coincide con la cabecera";
+        return false;
+    }
+
+    const unsigned char* valores = datos + sizeof(cabecera);
+
+    if (hashFnv1a(valores, cabecera.valores * bytesValor) != cabecera.sumaDatos) {
+        error = string(ruta) + ": la suma de verificacion no coincide";
+        return false;
+    }
+
+    fuente.vista.semilla = cabecera.semilla;
+    fuente.vista.valores = (size_t)cabecera.valores;
+    fuente.vista.sumaMascara = cabecera.sumaMascara;
+
+    if (cabecera.tipo == ENMASCARAMIENTO_PREIMAGENES) {
+        fuente.vista.preimagenes = valores;
+    }
+    else {
+        fuente.vista.sumas = (const uint16_t*)valores;
+    }
+
+    return true;
+
+}
+
+bool escribirEnmascaramientoBinario(const char* ruta, const DatosEnmascaramiento& datos, const unsigned char* M, int wM, int hM, bool preimagenes, string& error){
+    /*
+ * @brief Convierte un enmascaramiento leído de un archivo .txt al formato binario.
+ *
+ * @param ruta Archivo .bin de salida.
+ * @param datos Semilla y sumas del archivo de texto.
+ * @param M Máscara (RGB888 sin padding); se usa para calcular las preimágenes y su suma de verificación.
+ * @param wM Ancho de la máscara.
+ * @param hM Alto de la máscara.
+ * @param preimagenes true para guardar S(k) - M(k) como bytes en lugar de las sumas.
+ * @param error Mensaje si los datos no son compatibles con la máscara o no se pudo escribir.
+ */
+
+    size_t valores = (size_t)wM * hM * 3;
+
+    // La cabecera y las sumas se escriben tal como están en memoria: el formato es little-endian
+    if constexpr (endian::native != endian::little) {
+        error = string(ruta) + ": el formato binario solo se puede escribir en procesadores little-endian";
+        return false;
+    }
+
+    if (datos.sumas.size() != valores) {
+        error = string(ruta) + ": el enmascaramiento no tiene un triplete por cada pixel de la mascara";
+        return false;
+    }
+
+    CabeceraEnmascaramiento cabecera;
+    memset(&cabecera, 0, sizeof(cabecera));
+    memcpy(cabecera.magia, MAGIA_ENMASCARAMIENTO, 4);
+    cabecera.version = VERSION_ENMASCARAMIENTO;
+    cabecera.tipo = preimagenes ? ENMASCARAMIENTO_PREIMAGENES : ENMASCARAMIENTO_SUMAS;
+    cabecera.semilla = datos.semilla;
+    cabecera.anchoMascara = (uint32_t)wM;
+    cabecera.altoMascara = (uint32_t)hM;
+    cabecera.valores = valores;
+
+    vector<unsigned char> bytes;
+
+    if (preimagenes) {
+
+        vector<unsigned char> copia;
+        const unsigned char* objetivos = nullptr;
+
+        VistaEnmascaramiento vista;
+        vista.valores = valores;
+        vista.sumas = datos.sumas.data();
+
+        // Una suma que no se puede obtener con ningún byte no tiene preimagen
+        if (!objetivosEnmascaramiento(vista, M, valores, copia, objetivos)) {
+            error = string(ruta) + ": hay sumas sin preimagen para esta mascara (S(k) - M(k) fuera de 0..255)";
+            return false;
+        }
+
+        bytes.assign(objetivos, objetivos + valores);
+        cabecera.sumaMascara = hashFnv1a(M, valores);
+
+    }
+    else {
+
+        bytes.resize(valores * 2);
+        memcpy(bytes.data(), datos.sumas.data(), bytes.size());
+
+    }
+
+    cabecera.sumaDatos = hashFnv1a(bytes.data(), bytes.size());
+
+    FILE* archivo = fopen(ruta, "wb");
+
+    if (archivo == nullptr) {
+        error = string("No se pudo crear el archivo ") + ruta;
+        return false;
+    }
+
+    bool escrito = fwrite(&cabecera, sizeof(cabecera), 1, archivo) == 1 && fwrite(bytes.data(), 1, bytes.size(), archivo) == bytes.size();
+    escrito = (fclose(archivo) == 0) && escrito;
+
+    if (!escrito) {
+        error = string("No se pudo escribir el archivo ") + ruta;
+    }
+
+    return escrito;
+
+}
+
+bool objetivosEnmascaramiento(const VistaEnmascaramiento& vista, const unsigned char* M, size_t tamVentana, vector<unsigned char>& copia, const unsigned char*& objetivos){
+    /*
+ * @brief Obtiene los bytes que debe tener la ventana transformada: T(ID)(k + s) = S(k) - M(k).
+ *
+ * Con un archivo de preimágenes se devuelve directamente la proyección del archivo (si fue generado con esta
+ * misma máscara); con sumas se calculan en 'copia' con calcularObjetivos.
+ *
+ * @return false si la cantidad de valores no coincide con la ventana o si alguna suma no tiene preimagen.
+ */
+
+    objetivos = nullptr;
+
+    if (vista.valores != tamVentana) {
+        return false;
+    }
+
+    if (vista.preimagenes != nullptr) {
+
+        if (vista.sumaMascara != hashFnv1a(M, tamVentana)) {
+            return false;
+        }
+
+        objetivos = vista.preimagenes;
+        return true;
+
+    }
+
+    if (vista.sumas == nullptr || !calcularObjetivos(span<const uint16_t>(vista.sumas, tamVentana), span<const uint8_t>(M, tamVentana), copia)) {
+        return false;
+    }
+
+    objetivos = copia.data();
+    return true;
+
+}
+
+void cargarRanura(RanuraEnmascaramiento& ranura, const char* rutaTexto, const unsigned char* M, size_t tamVentana, const std::string* contenido){
+    /*
+ * @brief Abre el enmascaramiento de una etapa (prefiriendo el .bin) y calcula los bytes que debe tener su ventana.
+ *
+ * No escribe nada en pantalla, así que se puede llamar desde un hilo de carga; los errores quedan en la ranura.
+ *
+ * @param ranura Ranura que recibe el archivo; lo que tuviera antes se libera.
+ * @param rutaTexto Ruta del archivo M*.txt de la etapa.
+ * @param M Máscara (RGB888 sin padding); solo se lee.
+ * @param tamVentana Bytes de la máscara (i × j × 3).
+ * @param contenido Si no es nullptr, contenido del archivo ya recibido en memoria (rutaTexto solo da el nombre).
+ */
+
+    ranura.objetivos = nullptr;
+    ranura.error.clear();
+
+    if (contenido != nullptr) {
+        ranura.ruta = rutaTexto;
+        ranura.fuente.binario.cerrar();
+        ranura.abierto = abrirEnmascaramientoMemoria((const unsigned char*)contenido->data(), contenido->size(), rutaTexto, ranura.fuente, ranura.error);
+    }
+    else {
+        ranura.ruta = rutaEnmascaramiento(rutaTexto);
+        ranura.abierto = abrirEnmascaramiento(ranura.ruta.c_str(), ranura.fuente, ranura.error);
+    }
+
+    if (ranura.abierto) {
+        objetivosEnmascaramiento(ranura.fuente.vista, M, tamVentana, ranura.copiaObjetivos, ranura.objetivos);
+    }
+
+}
+
+
+/* ************************************************** Archivos de la versión original *********************************************************** */
+
+unsigned int* loadSeedMasking(const char* nombreArchivo, long long &seed, size_t &n_pixels){
+    /*
+ * @brief Carga la semilla y los resultados del enmascaramiento desde un archivo de texto.
+ *
+ * Esta función abre un archivo de texto que contiene una semilla en la primera línea y,
+ * a continuación, una lista de valores RGB resultantes del proceso de enmascaramiento.
+ * Primero cuenta cuántos tripletes de píxeles hay, luego reserva memoria dinámica
+ * y finalmente carga los valores en un arreglo de enteros.
+ *
+ * @param nombreArchivo Ruta del archivo de texto que contiene la semilla y los valores RGB.
+ * @param seed Variable de referencia donde se almacenará el valor entero de la semilla.
+ * @param n_pixels Variable de referencia donde se almacenará la cantidad de píxeles leídos
+ *                 (equivalente al número de líneas después de la semilla).
+ *
+ * @return Puntero a un arreglo dinámico de enteros que contiene los valores RGB
+ *         en orden secuencial (R, G, B, R, G, B, ...). Devuelve nullptr si ocurre un error al abrir el archivo.
+ *
+ * @note Es responsabilidad del usuario liberar la memoria reservada con delete[].
+ */
+
+    // Abrir el archivo que contiene la semilla y los valores RGB
+    ifstream archivo(nombreArchivo);
+    if (!archivo.is_open()) {
+        // Verificar si el archivo pudo abrirse correctamente
+        cout << "No se pudo abrir el archivo." << endl;
+        return nullptr;
+    }
+
+    // Leer la semilla desde la primera línea del archivo
+    archivo >> seed;
+
+    int r, g, b;
+
+    // Contar cuántos grupos de valores RGB hay en el archivo
+    // Se asume que cada línea después de la semilla tiene tres valores (r, g, b)
+    while (archivo >> r >> g >> b) {
+        n_pixels++;  // Contamos la cantidad de píxeles
+    }
+
+    // Cerrar el archivo para volver a abrirlo desde el inicio
+    archivo.close();
+    archivo.open(nombreArchivo);
+
+    // Verificar que se pudo reabrir el archivo correctamente
+    if (!archivo.is_open()) {
+        cout << "Error al reabrir el archivo." << endl;
+        return nullptr;
+    }
+
+    // Reservar memoria dinámica para guardar todos los valores RGB
+    // Cada píxel tiene 3 componentes: R, G y B
+    unsigned int* RGB = new unsigned int[n_pixels * 3];
+
+    // Leer nuevamente la semilla desde el archivo (se descarta su valor porque ya se cargó antes)
+    archivo >> seed;
+
+    // Leer y almacenar los valores RGB uno por uno en el arreglo dinámico
+    for (size_t i = 0; i < n_pixels * 3; i += 3) {
+        archivo >> r >> g >> b;
+        RGB[i] = r;
+        RGB[i + 1] = g;
+        RGB[i + 2] = b;
+    }
+
+    // Cerrar el archivo después de terminar la lectura
+    archivo.close();
+
+    // Mostrar información de control en consola
+    //cout << "Semilla: " << seed << endl;
+    //cout << "Cantidad de pixeles leidos: " << n_pixels << endl;
+
+    // Retornar el puntero al arreglo con los datos RGB
+    return RGB;
+}
+
+void enmascaramiento(const unsigned char* Id, int wId, int hId, const unsigned char* M, int wM, int hM, long long s, const char* archivoSalida){
+
+    size_t totalId=(size_t)wId*hId*3;
+    size_t totalM=(size_t)wM*hM*3;
+
+    // Validar tamaños
+    if (totalId < totalM) {
+        cout << "Error: La imagen ID es más pequeña que la máscara M." << endl;
+        return;
+    }
+
+    // La ventana [s, s + totalM) debe caber en la imagen
+    if (!ventanaEnImagen(s, totalM, totalId)) {
+        cout << "Error: La semilla " << s << " deja la mascara fuera de la imagen ID." << endl;
+        return;
+    }
+
+    // Abrir archivo para guardar salida
+    ofstream archivo(archivoSalida);
+    if (!archivo.is_open()) {
+        cout << "No se pudo abrir el archivo de salida." << endl;
+        return;
+    }
+
+    // Escribir la semilla en la primera línea
+    archivo << s << endl;
+
+    // Calcular y guardar las sumas S(k) = ID(k + s) + M(k)
+    for (size_t k = 0; k < totalM; k += 3) {
+        int r = (int)Id[s + k]     +(int)M[k];
+        int g = (int)Id[s + k + 1] + (int)M[k + 1];
+        int b = (int)Id[s + k + 2] + (int)M[k + 2];
+
+        archivo << r << " " << g << " " << b << endl;
+    }
+
+    archivo.close();
+    //cout << "Enmascaramiento completado. Archivo guardado: " << "Validacion.txt"<< endl;
+
+}
@@ -0,0 +1,128 @@
+#ifndef ARCHIVOS_H
+#define ARCHIVOS_H
+
+/* Lectura de los archivos de entrada sin pasar por iostream
+ *
+ * Los archivos se proyectan en memoria (mmap en POSIX, CreateFileMapping en Windows) y se recorren una sola vez.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Archivo de solo lectura proyectado en memoria; se libera al destruir el objeto
+class ArchivoMapeado {
+public:
+    ArchivoMapeado() = default;
+    ~ArchivoMapeado();
+
+    ArchivoMapeado(const ArchivoMapeado&) = delete;
+    ArchivoMapeado& operator=(const ArchivoMapeado&) = delete;
+
+    bool abrir(const char* ruta);
+    void cerrar();
+
+    const unsigned char* datos() const { return inicio; }
+    size_t tamano() const { return bytes; }
+
+private:
+    const unsigned char* inicio = nullptr;
+    size_t bytes = 0;
+#ifdef _WIN32
+    void* archivo = nullptr;
+    void* proyeccion = nullptr;
+#endif
+};
+
+// Contenido de un archivo de resultados del enmascaramiento (M*.txt)
+struct DatosEnmascaramiento {
+    long long semilla = 0;
+    std::vector<uint16_t> sumas;        // R, G, B, R, G, B, ... (cada suma es a lo sumo 255 + 255 = 510)
+
+    size_t n_pixels() const { return sumas.size() / 3; }
+};
+
+bool leerEnmascaramiento(const char* ruta, DatosEnmascaramiento& datos, std::string& error);
+bool leerEnmascaramientoTexto(const char* texto, size_t tam, const char* ruta, DatosEnmascaramiento& datos, std::string& error);
+
+
+/* ************************************** Formato binario de enmascaramiento ************************************** */
+
+/* Archivo .bin equivalente a un M*.txt, pensado para proyectarse en memoria y usarse sin convertir nada:
+ *
+ *      CabeceraEnmascaramiento (48 bytes) | valores
+ *
+ * Los valores son las sumas S(k) como uint16_t o, si tipo = ENMASCARAMIENTO_PREIMAGENES, los bytes S(k) - M(k)
+ * que debe tener la imagen transformada (uint8_t); estos últimos solo sirven con la misma máscara M, cuya suma
+ * de verificación queda en la cabecera. Todos los campos y los valores están en little-endian: se leen y escriben
+ * con memcpy, así que en un procesador big-endian el formato binario se rechaza y hay que usar los .txt.
+ *
+ * rutaEnmascaramiento usa el M*.bin en lugar del M*.txt solo si el binario no es más antiguo que el texto.
+ */
+
+const char MAGIA_ENMASCARAMIENTO[4] = {'D', '1', 'M', 'K'};
+const uint16_t VERSION_ENMASCARAMIENTO = 1;
+
+enum TipoEnmascaramiento : uint16_t { ENMASCARAMIENTO_SUMAS = 0, ENMASCARAMIENTO_PREIMAGENES = 1 };
+
+struct CabeceraEnmascaramiento {
+    char magia[4];
+    uint16_t version;
+    uint16_t tipo;
+    int64_t semilla;
+    uint32_t anchoMascara;
+    uint32_t altoMascara;
+    uint64_t valores;               // ancho × alto × 3
+    uint64_t sumaDatos;             // FNV-1a de los valores
+    uint64_t sumaMascara;           // FNV-1a de M (solo para preimágenes, 0 en otro caso)
+};
+
+static_assert(sizeof(CabeceraEnmascaramiento) == 48, "La cabecera del formato binario debe ocupar 48 bytes");
+
+// Vista de solo lectura de un enmascaramiento, sin importar de qué formato se cargó
+struct VistaEnmascaramiento {
+    long long semilla = 0;
+    size_t valores = 0;
+    const uint16_t* sumas = nullptr;            // Formato de texto o binario con sumas
+    const unsigned char* preimagenes = nullptr; // Binario con preimágenes
+    uint64_t sumaMascara = 0;
+};
+
+// Dueño de los datos de un enmascaramiento: el texto convertido o la proyección del archivo binario
+struct FuenteEnmascaramiento {
+    DatosEnmascaramiento texto;
+    ArchivoMapeado binario;
+    VistaEnmascaramiento vista;
+    size_t bytes = 0;                           // Tamaño del archivo leído
+};
+
+uint64_t hashFnv1a(const void* datos, size_t bytes, uint64_t hash = 1469598103934665603ULL);
+
+bool existeArchivo(const std::string& ruta);
+std::string rutaEnmascaramiento(const char* rutaTexto);
+bool abrirEnmascaramiento(const char* ruta, FuenteEnmascaramiento& fuente, std::string& error);
+bool abrirEnmascaramientoMemoria(const unsigned char* datos, size_t tam, const char* ruta, FuenteEnmascaramiento& fuente, std::string& error);
+bool escribirEnmascaramientoBinario(const char* ruta, const DatosEnmascaramiento& datos, const unsigned char* M, int wM, int hM, bool preimagenes, std::string& error);
+bool objetivosEnmascaramiento(const VistaEnmascaramiento& vista, const unsigned char* M, size_t tamVentana, std::vector<unsigned char>& copia, const unsigned char*& objetivos);
+
+// Enmascaramiento de una etapa listo para identificar: el archivo abierto y los bytes S(k) - M(k) de su ventana
+struct RanuraEnmascaramiento {
+    FuenteEnmascaramiento fuente;
+    std::vector<unsigned char> copiaObjetivos;
+    const unsigned char* objetivos = nullptr;   // nullptr si alguna suma no tiene preimagen para esta máscara
+    std::string ruta;                           // Archivo que se abrió (.bin o .txt)
+    bool abierto = false;
+    std::string error;
+};
+
+void cargarRanura(RanuraEnmascaramiento& ranura, const char* rutaTexto, const unsigned char* M, size_t tamVentana, const std::string* contenido = nullptr);
+
+
+/* ************************************** Archivos de la versión original ************************************** */
+
+// Lectura con ifstream (en dos pasadas) y escritura de Validacion.txt con ofstream; se conservan como referencia
+unsigned int* loadSeedMasking(const char* nombreArchivo, long long &seed, size_t &n_pixels);
+void enmascaramiento(const unsigned char* Id, int wId, int hId, const unsigned char* M, int wM, int hM, long long s, const char* archivoSalida = "Validacion.txt");
+
+#endif // ARCHIVOS_H
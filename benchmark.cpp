@@ -0,0 +1,526 @@
+/* Benchmarks del Desafío 1
+ *
+ * Mide, con datos aleatorios de semilla fija, los núcleos de operaciones a nivel de bits con distintos tamaños
+ * de buffer, el enmascaramiento y su verificación, la lectura de los archivos de enmascaramiento (la versión
+ * original con ifstream y la proyectada en memoria), la lectura y escritura de BMP, la identificación de una
+ * etapa y la reconstrucción completa de casos sintéticos de varios tamaños. Cada medición es la mediana de
+ * varias repeticiones después de una de calentamiento.
+ *
+ * Los resultados se escriben en JSON (bytes/s y, donde aplica, ns por candidato) para comparar versiones.
+ *
+ * --verify no mide nada: compara los núcleos de rotación y desplazamiento de cada nivel SIMD disponible (y sus
+ * tablas) con las operaciones escalares de referencia, para 0 a 8 bits, y termina con 1 si alguno difiere.
+ *
+ * Uso: Benchmark [--json archivo] [--reps N] [--quick] [--verify] [--simd nivel] [--threads N] [--dir temporal]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "archivos.h"
+#include "imagenes.h"
+#include "operaciones.h"
+#include "paralelo.h"
+#include "reconstruccion.h"
+
+using namespace std;
+
+/* ******************************* Declaración de funnciones ******************************* */
+
+struct Medicion {
+    string grupo;
+    string nombre;
+    size_t bytes;               // Bytes procesados por repetición
+    int repeticiones;
+    double segundos;            // Mediana de una repetición
+    double candidatos;          // Candidatos probados por repetición (0 si no aplica)
+};
+
+// Caso sintético en memoria: la imagen después de la última etapa y los enmascaramientos de todas las etapas
+struct CasoSintetico {
+    int ancho;
+    int alto;
+    vector<uint8_t> imagen;
+    vector<uint8_t> IM;
+    int wM;
+    int hM;
+    vector<uint8_t> M;
+    vector<long long> semillas;
+    vector<vector<uint16_t>> sumas;
+};
+
+template <typename Funcion>
+double medir(int repeticiones, Funcion&& funcion);
+void llenarAleatorio(mt19937_64& generador, vector<uint8_t>& datos);
+CasoSintetico generarCaso(int ancho, int alto, int wM, int hM, int etapas, unsigned long long semilla);
+string escribirJson(const vector<Medicion>& mediciones, int hilos);
+bool verificarNucleos();
+
+
+/* ********************************************* Función Principal ************************************************ */
+
+int main(int argc, char* argv[])
+{
+    string rutaJson;
+    string directorio = filesystem::temp_directory_path().string();
+    int repeticiones = 5;
+    int cantidadHilos = 0;
+    bool rapido = false;
+    bool verificar = false;
+
+    for (int a=1;a<argc;a++){
+
+        string opcion = argv[a];
+
+        if (opcion=="--json" && a+1<argc){
+            rutaJson = argv[++a];
+        }
+
+        else if (opcion=="--reps" && a+1<argc){
+            repeticiones = max(1, atoi(argv[++a]));
+        }
+
+        // --quick usa los tamaños pequeños de cada grupo, para revisar que todo corre
+        else if (opcion=="--quick"){
+            rapido = true;
+        }
+
+        else if (opcion=="--verify"){
+            verificar = true;
+        }
+
+        else if (opcion=="--simd" && a+1<argc){
+
+            NivelSimd nivel;
+
+            if (!leerNivelSimd(argv[++a], nivel) || !seleccionarNivelSimd(nivel)){
+                cerr<<"Nivel SIMD no disponible, se usa: "<<nombreNivelSimd(nivelSimdActivo())<<endl;
+            }
+
+        }
+
+        else if (opcion=="--threads" && a+1<argc){
+            cantidadHilos = atoi(argv[++a]);
+        }
+
+        else if (opcion=="--dir" && a+1<argc){
+            directorio = argv[++a];
+        }
+
+        else{
+            cerr<<"Uso: "<<argv[0]<<" [--json archivo] [--reps N] [--quick] [--verify] [--simd nivel] [--threads N] [--dir temporal]"<<endl;
+            return 1;
+        }
+
+    }
+
+    if (verificar){
+        return verificarNucleos() ? 0 : 1;
+    }
+
+    directorio += "/";
+
+    vector<Medicion> mediciones;
+    mt19937_64 generador(2024);
+    PoolHilos pool(cantidadHilos);
+
+    auto registrar = [&](const string& grupo, const string& nombre, size_t bytes, double segundos, double candidatos){
+
+        mediciones.push_back({grupo, nombre, bytes, repeticiones, segundos, candidatos});
+        cerr<<grupo<<"/"<<nombre<<" ("<<bytes<<" bytes): "<<segundos * 1e3<<" ms, "<<(bytes / segundos) / 1e6<<" MB/s"<<endl;
+
+    };
+
+    /* ------------------------------------------ Núcleos sobre buffers ------------------------------------------ */
+
+    vector<size_t> tamanos = rapido ? vector<size_t>{4096, 262144} : vector<size_t>{4096, 262144, 16777216, 134217728};
+
+    for (size_t tam : tamanos) {
+
+        vector<uint8_t> origen(tam), IM(tam), destino(tam);
+        llenarAleatorio(generador, origen);
+        llenarAleatorio(generador, IM);
+
+        // Los buffers pequeños se recorren muchas veces por repetición para que el reloj tenga resolución
+        int vueltas = (int)max<size_t>(1, ((size_t)64 << 20) / tam);
+        unsigned char tabla[256];
+
+        for (int v = 0; v < 256; v++) tabla[v] = rotacionIzq((unsigned char)v, 3);
+
+        struct Nucleo { const char* nombre; function<void()> ejecutar; };
+
+        Nucleo nucleos[] = {
+            {"xor",                [&]{ xorBuffer(origen.data(), IM.data(), destino.data(), tam); }},
+            {"rotacion_izq_3",     [&]{ rotacionIzqBuffer(origen.data(), destino.data(), tam, 3); }},
+            {"rotacion_der_3",     [&]{ rotacionDerBuffer(origen.data(), destino.data(), tam, 3); }},
+            {"desplazamiento_izq_3", [&]{ desplazamientoIzqBuffer(origen.data(), destino.data(), tam, 3); }},
+            {"desplazamiento_der_3", [&]{ desplazamientoDerBuffer(origen.data(), destino.data(), tam, 3); }},
+            {"tabla",              [&]{ tablaBuffer(origen.data(), destino.data(), tam, tabla); }},
+        };
+
+        for (Nucleo& nucleo : nucleos) {
+
+            double segundos = medir(repeticiones, [&]{ for (int v = 0; v < vueltas; v++) nucleo.ejecutar(); });
+            registrar("nucleo", string(nucleo.nombre) + "_" + to_string(tam), tam * vueltas, segundos, 0);
+
+        }
+
+        // La misma operación repartida en franjas entre los hilos del pool, como en la reconstrucción
+        double segundos = medir(repeticiones, [&]{
+            for (int v = 0; v < vueltas; v++) aplicarOperacionEnFranjas(pool, {OP_ROTACION_IZQ, 3}, origen.data(), destino.data(), IM.data(), tam, 4096);
+        });
+        registrar("nucleo", "rotacion_izq_3_franjas_" + to_string(tam), tam * vueltas, segundos, 0);
+
+    }
+
+    /* ------------------------------- Enmascaramiento, verificación y lectura ------------------------------- */
+
+    vector<pair<int, int>> mascaras = rapido ? vector<pair<int, int>>{{40, 40}} : vector<pair<int, int>>{{40, 40}, {500, 500}, {2000, 2000}};
+
+    for (auto [wM, hM] : mascaras) {
+
+        CasoSintetico caso = generarCaso(max(wM, 512), max(hM, 512), wM, hM, 0, 7);
+        size_t tamVentana = caso.M.size();
+        string nombre = to_string(wM) + "x" + to_string(hM);
+        string ruta = directorio + "benchmark_M" + nombre + ".txt";
+        string rutaBin = directorio + "benchmark_M" + nombre + ".bin";
+        long long semilla = caso.semillas[0];
+
+        double segundos = medir(repeticiones, [&]{ enmascaramiento(caso.imagen.data(), caso.ancho, caso.alto, caso.M.data(), wM, hM, semilla, ruta.c_str()); });
+        registrar("enmascaramiento", "escribir_txt_" + nombre, tamVentana, segundos, 0);
+
+        VistaImagen mascara = {caso.M, wM, hM};
+        bool verificado = false;
+
+        segundos = medir(repeticiones, [&]{ verificado = verificarEnmascaramiento(caso.imagen, mascara, semilla, caso.sumas[0]); });
+        registrar("enmascaramiento", "verificar_" + nombre, tamVentana, segundos, 0);
+
+        if (!verificado){
+            cerr<<"La verificacion del enmascaramiento "<<nombre<<" fallo"<<endl;
+            return 1;
+        }
+
+        size_t bytesArchivo = (size_t)filesystem::file_size(ruta);
+
+        segundos = medir(repeticiones, [&]{
+            long long semillaLeida = 0;
+            size_t pixeles = 0;
+            delete [] loadSeedMasking(ruta.c_str(), semillaLeida, pixeles);
+        });
+        registrar("lectura", "loadSeedMasking_" + nombre, bytesArchivo, segundos, 0);
+
+        DatosEnmascaramiento datos;
+        string error;
+
+        segundos = medir(repeticiones, [&]{ leerEnmascaramiento(ruta.c_str(), datos, error); });
+        registrar("lectura", "leerEnmascaramiento_" + nombre, bytesArchivo, segundos, 0);
+
+        escribirEnmascaramientoBinario(rutaBin.c_str(), datos, caso.M.data(), wM, hM, false, error);
+
+        FuenteEnmascaramiento fuente;
+
+        segundos = medir(repeticiones, [&]{ abrirEnmascaramiento(rutaBin.c_str(), fuente, error); });
+        registrar("lectura", "abrirEnmascaramiento_bin_" + nombre, (size_t)filesystem::file_size(rutaBin), segundos, 0);
+
+        fuente.binario.cerrar();
+        filesystem::remove(ruta);
+        filesystem::remove(rutaBin);
+
+    }
+
+    /* ------------------------------------------------ BMP ------------------------------------------------ */
+
+    vector<int> lados = rapido ? vector<int>{512} : vector<int>{512, 2048, 8192};
+
+    for (int lado : lados) {
+
+        vector<uint8_t> rgb((size_t)lado * lado * 3);
+        llenarAleatorio(generador, rgb);
+
+        string nombre = to_string(lado) + "x" + to_string(lado);
+        string ruta = directorio + "benchmark_" + nombre + ".bmp";
+        string error;
+
+        double segundos = medir(repeticiones, [&]{ escribirBmp(ruta.c_str(), rgb.data(), lado, lado, error); });
+        registrar("bmp", "escribir_" + nombre, rgb.size(), segundos, 0);
+
+        ImagenRgb imagen;
+
+        segundos = medir(repeticiones, [&]{ cargarRgb(ruta.c_str(), imagen, error); });
+        registrar("bmp", "leer_" + nombre, rgb.size(), segundos, 0);
+
+        filesystem::remove(ruta);
+
+    }
+
+    /* ----------------------------------------- Identificación y reconstrucción ----------------------------------------- */
+
+    Operacion candidatos[NUM_CANDIDATOS];
+    generarCandidatos(candidatos);
+
+    unsigned char tablas[NUM_CANDIDATOS][256];
+    generarTablas(candidatos, tablas);
+
+    struct Escenario { int ancho; int alto; int wM; int hM; int etapas; };
+
+    vector<Escenario> escenarios = rapido ? vector<Escenario>{{512, 512, 40, 40, 4}} : vector<Escenario>{{512, 512, 40, 40, 4}, {2048, 2048, 200, 200, 6}, {8192, 8192, 1000, 1000, 6}};
+
+    for (const Escenario& escenario : escenarios) {
+
+        CasoSintetico caso = generarCaso(escenario.ancho, escenario.alto, escenario.wM, escenario.hM, escenario.etapas, 11);
+        string nombre = to_string(escenario.ancho) + "x" + to_string(escenario.alto) + "_M" + to_string(escenario.wM) + "x" + to_string(escenario.hM) + "_" + to_string(escenario.etapas) + "etapas";
+
+        // Identificación de la última etapa transformada: un recorrido de la ventana con los 33 candidatos
+        int ultima = escenario.etapas - 1;
+        vector<uint8_t> objetivos;
+        calcularObjetivos(caso.sumas[ultima], caso.M, objetivos);
+
+        long long s = caso.semillas[ultima];
+        double segundos = medir(repeticiones, [&]{ identificarOperacion(caso.imagen.data() + s, caso.IM.data() + s, objetivos.data(), objetivos.size(), tablas); });
+        registrar("identificacion", nombre, objetivos.size(), segundos, NUM_CANDIDATOS);
+
+        // Reconstrucción completa sobre una copia de la imagen en cada repetición
+        vector<EtapaEnmascaramiento> etapas(caso.sumas.size());
+
+        for (size_t e = 0; e < etapas.size(); e++) {
+            etapas[e].semilla = caso.semillas[e];
+            etapas[e].sumas = caso.sumas[e];
+        }
+
+        ConfiguracionReconstruccion config;
+        config.pool = &pool;
+
+        vector<uint8_t> imagen;
+        bool reconstruido = true;
+
+        segundos = medir(repeticiones, [&]{
+            imagen = caso.imagen;
+            ResultadoReconstruccion resultado = reconstruir(imagen, caso.ancho, caso.alto, {caso.IM, caso.ancho, caso.alto}, {caso.M, caso.wM, caso.hM}, etapas, config);
+            reconstruido = reconstruido && resultado.estado == RECONSTRUCCION_COMPLETA;
+        });
+
+        if (!reconstruido){
+            cerr<<"No se pudo reconstruir el caso "<<nombre<<endl;
+            return 1;
+        }
+
+        registrar("reconstruccion", nombre, caso.imagen.size() * etapas.size(), segundos, (double)NUM_CANDIDATOS * etapas.size());
+
+    }
+
+    string json = escribirJson(mediciones, pool.cantidadHilos());
+
+    if (rutaJson.empty()){
+        cout<<json;
+        return 0;
+    }
+
+    FILE* archivo = fopen(rutaJson.c_str(), "w");
+
+    if (archivo == nullptr){
+        cerr<<"No se pudo escribir "<<rutaJson<<endl;
+        return 1;
+    }
+
+    fputs(json.c_str(), archivo);
+    fclose(archivo);
+
+    return 0;
+}
+
+
+/* ************************************************** Funiciones *********************************************************** */
+
+template <typename Funcion>
+double medir(int repeticiones, Funcion&& funcion){
+    /*
+ * @brief Ejecuta la función una vez para calentar cachés y después 'repeticiones' veces.
+ *
+ * @return La mediana, en segundos, de las repeticiones medidas.
+ */
+
+    funcion();
+
+    vector<double> tiempos;
+
+    for (int r = 0; r < repeticiones; r++) {
+
+        auto inicio = chrono::steady_clock::now();
+        funcion();
+        tiempos.push_back(chrono::duration<double>(chrono::steady_clock::now() - inicio).count());
+
+    }
+
+    sort(tiempos.begin(), tiempos.end());
+
+    return tiempos[tiempos.size() / 2];
+
+}
+
+bool verificarNucleos(){
+    /*
+ * @brief Compara rotacionIzqBuffer, rotacionDerBuffer, desplazamientoIzqBuffer y desplazamientoDerBuffer, fuera
+ * de lugar y en el mismo lugar, y tablaOperacion con las funciones escalares para todos los bytes y de 0 a 8 bits.
+ *
+ * El tamaño no es múltiplo de 64 para que también se recorra la cola escalar de los bucles vectorizados.
+ * Se prueban todos los niveles que soporta el procesador y al final se deja activo el nivel que estaba.
+ */
+
+    const size_t TAM = 4096 + 77;
+    const char* nombres[5] = {"xor", "rotacion_izq", "rotacion_der", "desplazamiento_izq", "desplazamiento_der"};
+    unsigned char (*referencias[5])(unsigned char, int) = {nullptr, rotacionIzq, rotacionDer, desplazamientoIzq, desplazamientoDer};
+    void (*buffers[5])(const unsigned char*, unsigned char*, size_t, int) = {nullptr, rotacionIzqBuffer, rotacionDerBuffer, desplazamientoIzqBuffer, desplazamientoDerBuffer};
+
+    vector<uint8_t> origen(TAM), destino(TAM), enLugar(TAM);
+
+    for (size_t i = 0; i < TAM; i++) origen[i] = (uint8_t)(i * 131 + i / 256);
+
+    NivelSimd inicial = nivelSimdActivo();
+    int fallos = 0;
+    int pruebas = 0;
+
+    for (int nivel = SIMD_ESCALAR; nivel <= detectarNivelSimd(); nivel++) {
+
+        seleccionarNivelSimd((NivelSimd)nivel);
+
+        for (int tipo = OP_ROTACION_IZQ; tipo <= OP_DESPLAZAMIENTO_DER; tipo++) {
+
+            for (int n = 0; n <= 8; n++) {
+
+                const unsigned char* tabla = tablaOperacion({(TipoOperacion)tipo, n});
+
+                buffers[tipo](origen.data(), destino.data(), TAM, n);
+                enLugar = origen;
+                buffers[tipo](enLugar.data(), enLugar.data(), TAM, n);
+
+                bool iguales = true;
+
+                for (size_t i = 0; i < TAM && iguales; i++) {
+                    unsigned char esperado = referencias[tipo](origen[i], n);
+                    iguales = (destino[i] == esperado && enLugar[i] == esperado && tabla[origen[i]] == esperado);
+                }
+
+                pruebas++;
+
+                if (!iguales){
+                    cerr<<nombreNivelSimd((NivelSimd)nivel)<<": "<<nombres[tipo]<<" de "<<n<<" bits no coincide con la referencia"<<endl;
+                    fallos++;
+                }
+
+            }
+
+        }
+
+    }
+
+    seleccionarNivelSimd(inicial);
+
+    cout<<pruebas - fallos<<" de "<<pruebas<<" nucleos coinciden con la referencia"<<endl;
+
+    return fallos == 0;
+
+}
+
+void llenarAleatorio(mt19937_64& generador, vector<uint8_t>& datos){
+
+    for (size_t k = 0; k < datos.size(); k += 8) {
+
+        uint64_t valor = generador();
+
+        for (size_t b = k; b < k + 8 && b < datos.size(); b++, valor >>= 8) {
+            datos[b] = (uint8_t)valor;
+        }
+
+    }
+
+}
+
+CasoSintetico generarCaso(int ancho, int alto, int wM, int hM, int etapas, unsigned long long semilla){
+    /*
+ * @brief Genera en memoria un caso como el de Generador: una XOR o rotación por etapa y un enmascaramiento antes de cada una.
+ *
+ * Con 'etapas' transformaciones hay etapas + 1 enmascaramientos; el último se toma sobre la imagen final.
+ */
+
+    mt19937_64 generador(semilla);
+
+    CasoSintetico caso;
+    caso.ancho = ancho;
+    caso.alto = alto;
+    caso.wM = wM;
+    caso.hM = hM;
+    caso.imagen.resize((size_t)ancho * alto * 3);
+    caso.IM.resize(caso.imagen.size());
+    caso.M.resize((size_t)wM * hM * 3);
+
+    llenarAleatorio(generador, caso.imagen);
+    llenarAleatorio(generador, caso.IM);
+    llenarAleatorio(generador, caso.M);
+
+    uniform_int_distribution<size_t> sorteoSemilla(0, caso.imagen.size() - caso.M.size());
+    uniform_int_distribution<int> sorteoOperacion(0, 2);
+    uniform_int_distribution<int> sorteoBits(1, 7);
+
+    for (int etapa = 0; etapa <= etapas; etapa++) {
+
+        if (etapa > 0){
+            Operacion op = {(TipoOperacion)sorteoOperacion(generador), sorteoBits(generador)};
+            aplicarOperacion(op, caso.imagen.data(), caso.imagen.data(), caso.IM.data(), caso.imagen.size());
+        }
+
+        long long s = (long long)sorteoSemilla(generador);
+        vector<uint16_t> sumas(caso.M.size());
+
+        for (size_t k = 0; k < sumas.size(); k++) {
+            sumas[k] = (uint16_t)(caso.imagen[s + k] + caso.M[k]);
+        }
+
+        caso.semillas.push_back(s);
+        caso.sumas.push_back(move(sumas));
+
+    }
+
+    return caso;
+
+}
+
+string escribirJson(const vector<Medicion>& mediciones, int hilos){
+
+    ostringstream json;
+    json.precision(6);
+
+    json<<"{"<<endl;
+    json<<"  \"simd\": \""<<nombreNivelSimd(nivelSimdActivo())<<"\","<<endl;
+    json<<"  \"hilos\": "<<hilos<<","<<endl;
+    json<<"  \"resultados\": ["<<endl;
+
+    for (size_t i = 0; i < mediciones.size(); i++) {
+
+        const Medicion& m = mediciones[i];
+
+        json<<"    {\"grupo\": \""<<m.grupo<<"\", \"nombre\": \""<<m.nombre<<"\", \"bytes\": "<<m.bytes<<", \"repeticiones\": "<<m.repeticiones;
+        json<<", \"segundos\": "<<m.segundos<<", \"bytes_por_segundo\": "<<(m.bytes / m.segundos);
+
+        if (m.candidatos > 0){
+            json<<", \"ns_por_candidato\": "<<(m.segundos * 1e9 / m.candidatos);
+        }
+
+        json<<"}"<<(i + 1 < mediciones.size() ? "," : "")<<endl;
+
+    }
+
+    json<<"  ]"<<endl;
+    json<<"}"<<endl;
+
+    return json.str();
+
+}
@@ -0,0 +1,375 @@
+#include "busqueda.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
+
+using namespace std;
+
+
+/* ************************************************** Secuencias de operaciones *********************************************************** */
+
+void aplicarSecuencia(const vector<Operacion>& secuencia, const unsigned char* origen, unsigned char* destino, const unsigned char* IM, size_t size){
+
+    if (secuencia.empty()) {
+        if (origen != destino) memcpy(destino, origen, size);
+        return;
+    }
+
+    // La primera operación lee del origen y las siguientes trabajan en el mismo lugar sobre el destino
+    aplicarOperacion(secuencia[0], origen, destino, IM, size);
+
+    for (size_t i = 1; i < secuencia.size(); i++) {
+        aplicarOperacion(secuencia[i], destino, destino, IM, size);
+    }
+
+}
+
+string nombreSecuencia(const vector<Operacion>& secuencia){
+
+    string nombre;
+
+    for (size_t i = 0; i < secuencia.size(); i++) {
+        if (i > 0) nombre += ", luego ";
+        nombre += nombreOperacion(secuencia[i]);
+    }
+
+    return nombre;
+
+}
+
+// Secuencias que equivalen a otra más corta: dos XOR seguidas se cancelan y dos rotaciones seguidas son una sola rotación
+static bool esRedundante(const Operacion& anterior, const Operacion& siguiente){
+
+    if (anterior.tipo == OP_XOR && siguiente.tipo == OP_XOR) {
+        return true;
+    }
+
+    bool rotacionAnterior = (anterior.tipo == OP_ROTACION_IZQ || anterior.tipo == OP_ROTACION_DER);
+    bool rotacionSiguiente = (siguiente.tipo == OP_ROTACION_IZQ || siguiente.tipo == OP_ROTACION_DER);
+
+    return rotacionAnterior && rotacionSiguiente;
+
+}
+
+
+/* ************************************************** Ventanas de enmascaramiento *********************************************************** */
+
+VentanasCaso calcularVentanas(span<const long long> semillas, size_t tamVentana, size_t totalBytes){
+    /*
+ * @brief Une las ventanas [semilla, semilla + tamVentana) de las etapas que caben en la imagen.
+ *
+ * Las ventanas que se solapan o se tocan quedan en un solo intervalo; la copia compacta tiene los intervalos uno
+ * tras otro, en orden. Una semilla negativa o cuya ventana no cabe queda fuera de la unión, con inicio -1.
+ */
+
+    VentanasCaso ventanas;
+    vector<pair<size_t, size_t>> intervalos;
+
+    for (long long semilla : semillas) {
+        if (tamVentana > 0 && ventanaEnImagen(semilla, tamVentana, totalBytes)) {
+            intervalos.push_back({(size_t)semilla, (size_t)semilla + tamVentana});
+        }
+    }
+
+    sort(intervalos.begin(), intervalos.end());
+
+    for (const pair<size_t, size_t>& intervalo : intervalos) {
+        if (!ventanas.intervalos.empty() && intervalo.first <= ventanas.intervalos.back().second) {
+            ventanas.intervalos.back().second = max(ventanas.intervalos.back().second, intervalo.second);
+        }
+        else {
+            ventanas.intervalos.push_back(intervalo);
+        }
+    }
+
+    vector<size_t> inicioCompacto;
+
+    for (const pair<size_t, size_t>& intervalo : ventanas.intervalos) {
+        inicioCompacto.push_back(ventanas.bytes);
+        ventanas.bytes += intervalo.second - intervalo.first;
+    }
+
+    ventanas.inicios.assign(semillas.size(), -1);
+
+    for (size_t e = 0; e < semillas.size(); e++) {
+
+        long long semilla = semillas[e];
+
+        if (tamVentana == 0 || !ventanaEnImagen(semilla, tamVentana, totalBytes)) {
+            continue;
+        }
+
+        for (size_t u = 0; u < ventanas.intervalos.size(); u++) {
+            if ((size_t)semilla >= ventanas.intervalos[u].first && (size_t)semilla + tamVentana <= ventanas.intervalos[u].second) {
+                ventanas.inicios[e] = (long long)(inicioCompacto[u] + ((size_t)semilla - ventanas.intervalos[u].first));
+                break;
+            }
+        }
+
+    }
+
+    return ventanas;
+
+}
+
+
+/* ************************************************** Búsqueda con retroceso *********************************************************** */
+
+class Buscador {
+public:
+    Buscador(const unsigned char* imagen, const unsigned char* IM, const VentanasCaso& ubicacion, size_t tamVentana, const EtapaBusqueda* etapas, int numEtapas, const ConfiguracionBusqueda& config);
+
+    ResultadoBusqueda buscar();
+
+private:
+    bool resolver(int etapa);
+    bool ventanaCoincide(int etapa, const vector<Operacion>& secuencia);
+    bool presupuestoAgotado();
+    unsigned long long hashEstado(int etapa) const;
+    bool estadoVisitado(int etapa);
+
+    size_t tamVentana;
+    int numEtapas;
+    ConfiguracionBusqueda config;
+
+    Operacion candidatos[NUM_CANDIDATOS];
+
+    // Copia compacta de la unión de las ventanas: estados[e] es la imagen al empezar la etapa e
+    vector<vector<unsigned char>> estados;
+    vector<unsigned char> imCompacta;
+    vector<size_t> desplazamientos;             // Posición de la ventana de cada etapa dentro de la copia compacta
+    vector<const unsigned char*> objetivos;     // S(k) - M(k) de cada etapa
+    vector<bool> etapaPosible;
+
+    vector<unsigned char> ventana;
+    vector<vector<Operacion>> secuencias;
+    // Estados explorados, agrupados por hash; el hash solo agrupa, cada estado se confirma con (etapa, bytes)
+    unordered_map<unsigned long long, vector<pair<int, vector<unsigned char>>>> visitados;
+
+    long long nodos = 0;
+    bool sinPresupuesto = false;
+    chrono::steady_clock::time_point inicio;
+};
+
+Buscador::Buscador(const unsigned char* imagen, const unsigned char* IM, const VentanasCaso& ubicacion, size_t tamVentana, const EtapaBusqueda* etapas, int numEtapas, const ConfiguracionBusqueda& config)
+    : tamVentana(tamVentana), numEtapas(numEtapas), config(config),
+      estados(numEtapas + 1), desplazamientos(numEtapas, 0), objetivos(numEtapas), etapaPosible(numEtapas, true),
+      ventana(tamVentana), secuencias(numEtapas){
+
+    generarCandidatos(candidatos);
+
+    for (int e = 0; e < numEtapas; e++) {
+
+        // Sin objetivos alguna suma no tiene preimagen: ninguna operación produce un byte fuera de 0..255
+        if (etapas[e].objetivos == nullptr || ubicacion.inicios[e] < 0) {
+            etapaPosible[e] = false;
+            continue;
+        }
+
+        objetivos[e] = etapas[e].objetivos;
+        desplazamientos[e] = (size_t)ubicacion.inicios[e];
+
+    }
+
+    // Copia compacta: los intervalos de la unión uno tras otro
+    for (const pair<size_t, size_t>& intervalo : ubicacion.intervalos) {
+        estados[0].insert(estados[0].end(), imagen + intervalo.first, imagen + intervalo.second);
+        imCompacta.insert(imCompacta.end(), IM + intervalo.first, IM + intervalo.second);
+    }
+
+    for (int e = 1; e <= numEtapas; e++) {
+        estados[e].resize(estados[0].size());
+    }
+
+}
+
+ResultadoBusqueda Buscador::buscar(){
+
+    inicio = chrono::steady_clock::now();
+
+    bool encontrada = resolver(0);
+
+    ResultadoBusqueda resultado;
+    resultado.estado = encontrada ? BUSQUEDA_ENCONTRADA : (sinPresupuesto ? BUSQUEDA_SIN_PRESUPUESTO : BUSQUEDA_AGOTADA);
+    resultado.nodos = nodos;
+    resultado.milisegundos = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - inicio).count();
+
+    if (encontrada) {
+        resultado.secuencias = secuencias;
+    }
+
+    return resultado;
+
+}
+
+bool Buscador::presupuestoAgotado(){
+
+    if (sinPresupuesto) {
+        return true;
+    }
+
+    if (nodos >= config.maxNodos) {
+        sinPresupuesto = true;
+    }
+
+    // El reloj se consulta cada 64 nodos para no pagar una llamada al sistema por secuencia
+    else if ((nodos & 63) == 0) {
+        long long transcurrido = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - inicio).count();
+        sinPresupuesto = (transcurrido >= config.maxMilisegundos);
+    }
+
+    return sinPresupuesto;
+
+}
+
+unsigned long long Buscador::hashEstado(int etapa) const{
+
+    // FNV-1a de 64 bits sobre la copia compacta, combinado con el número de etapa
+    unsigned long long hash = 1469598103934665603ULL ^ (unsigned long long)etapa;
+
+    for (unsigned char byte : estados[etapa]) {
+        hash ^= byte;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+
+}
+
+bool Buscador::estadoVisitado(int etapa){
+
+    // Dos estados distintos pueden tener el mismo hash: solo se descarta la rama si los bytes son iguales
+    vector<pair<int, vector<unsigned char>>>& grupo = visitados[hashEstado(etapa)];
+
+    for (const pair<int, vector<unsigned char>>& estado : grupo) {
+        if (estado.first == etapa && memcmp(estado.second.data(), estados[etapa].data(), estados[etapa].size()) == 0) {
+            return true;
+        }
+    }
+
+    grupo.push_back({etapa, estados[etapa]});
+    return false;
+
+}
+
+bool Buscador::ventanaCoincide(int etapa, const vector<Operacion>& secuencia){
+
+    const unsigned char* origen = estados[etapa].data() + desplazamientos[etapa];
+    const unsigned char* im = imCompacta.data() + desplazamientos[etapa];
+
+    aplicarSecuencia(secuencia, origen, ventana.data(), im, tamVentana);
+
+    return memcmp(ventana.data(), objetivos[etapa], tamVentana) == 0;
+
+}
+
+bool Buscador::resolver(int etapa){
+
+    if (etapa == numEtapas) {
+        return true;
+    }
+
+    if (!etapaPosible[etapa] || presupuestoAgotado()) {
+        return false;
+    }
+
+    // Un estado que ya se exploró desde esta etapa no tiene solución (si la tuviera, la búsqueda habría terminado)
+    if (estadoVisitado(etapa)) {
+        return false;
+    }
+
+    // Primero todas las secuencias de una operación, luego las de dos, etc.
+    for (int largo = 1; largo <= config.maxOperaciones; largo++) {
+
+        vector<int> indices(largo, 0);
+        vector<Operacion> secuencia(largo);
+
+        while (true) {
+
+            bool redundante = false;
+
+            for (int i = 0; i < largo; i++) {
+                secuencia[i] = candidatos[indices[i]];
+                if (i > 0 && esRedundante(secuencia[i - 1], secuencia[i])) redundante = true;
+            }
+
+            if (!redundante) {
+
+                nodos++;
+
+                if (presupuestoAgotado()) {
+                    return false;
+                }
+
+                // La ventana de la etapa decide; solo si coincide se transforma el resto de la copia compacta
+                if (ventanaCoincide(etapa, secuencia)) {
+
+                    aplicarSecuencia(secuencia, estados[etapa].data(), estados[etapa + 1].data(), imCompacta.data(), estados[etapa].size());
+                    secuencias[etapa] = secuencia;
+
+                    if (resolver(etapa + 1)) {
+                        return true;
+                    }
+
+                    if (sinPresupuesto) {
+                        return false;
+                    }
+
+                }
+
+            }
+
+            // Siguiente combinación de índices (como un odómetro)
+            int posicion = largo - 1;
+
+            while (posicion >= 0 && ++indices[posicion] == NUM_CANDIDATOS) {
+                indices[posicion] = 0;
+                posicion--;
+            }
+
+            if (posicion < 0) {
+                break;
+            }
+
+        }
+
+    }
+
+    return false;
+
+}
+
+ResultadoBusqueda buscarReconstruccion(const unsigned char* imagen, const unsigned char* IM, size_t totalBytes, size_t tamVentana, const EtapaBusqueda* etapas, int numEtapas, const ConfiguracionBusqueda& config){
+    /*
+ * @brief Busca, para varias etapas seguidas, secuencias de operaciones que expliquen sus enmascaramientos.
+ *
+ * Recorre las etapas en el orden dado (etapas[0] es la primera que se revierte) probando por etapa las secuencias
+ * de 1 a config.maxOperaciones operaciones, en el orden de prioridad de los candidatos. Una secuencia se acepta
+ * si la ventana transformada coincide con el archivo de la etapa; entonces se pasa a la siguiente etapa y, si esta
+ * no tiene solución, se retrocede. Los estados ya explorados (etapa y bytes de las ventanas) no se repiten.
+ *
+ * @param imagen Imagen al empezar la primera etapa (RGB888 sin padding).
+ * @param IM Imagen I_M para las operaciones XOR.
+ * @param totalBytes Tamaño de la imagen y de I_M en bytes.
+ * @param tamVentana Bytes de la máscara (i × j × 3).
+ * @param etapas Semilla y bytes esperados S(k) - M(k) de cada etapa, en el orden en que se revierten.
+ * @param numEtapas Cantidad de etapas.
+ * @param config Límites de profundidad, nodos y tiempo.
+ *
+ * @return Las secuencias de cada etapa, o el motivo por el que no se encontraron (búsqueda agotada o sin presupuesto).
+ */
+
+    // Solo se copian las ventanas de las etapas que pueden tener solución
+    vector<long long> semillas(numEtapas, -1);
+
+    for (int e = 0; e < numEtapas; e++) {
+        if (etapas[e].objetivos != nullptr) semillas[e] = etapas[e].semilla;
+    }
+
+    Buscador buscador(imagen, IM, calcularVentanas(semillas, tamVentana, totalBytes), tamVentana, etapas, numEtapas, config);
+
+    return buscador.buscar();
+
+}
@@ -0,0 +1,54 @@
+#ifndef BUSQUEDA_H
+#define BUSQUEDA_H
+
+/* Búsqueda con retroceso de la secuencia de operaciones de cada etapa
+ *
+ * Se usa cuando ninguna operación individual explica una etapa: prueba secuencias de hasta
+ * maxOperaciones operaciones por etapa (por ejemplo XOR y luego una rotación) y, si una etapa posterior
+ * no tiene solución, retrocede y prueba otra secuencia en las etapas anteriores.
+ *
+ * Como todas las operaciones son byte a byte, la búsqueda solo necesita los bytes de las ventanas de
+ * enmascaramiento de las etapas: se trabaja sobre una copia compacta con la unión de esas ventanas.
+ */
+
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "operaciones.h"
+
+// Datos del archivo de enmascaramiento de una etapa
+struct EtapaBusqueda {
+    long long semilla;
+    const unsigned char* objetivos;     // S(k) - M(k) para k en la ventana; nullptr si alguna suma no tiene preimagen
+};
+
+// Unión de las ventanas de enmascaramiento de un caso dentro de la imagen completa
+struct VentanasCaso {
+    std::vector<std::pair<size_t, size_t>> intervalos;     // [inicio, fin) en bytes de la imagen, ordenados y sin solaparse
+    std::vector<long long> inicios;                         // Posición de la ventana de cada etapa en la copia compacta; -1 si no cabe
+    size_t bytes = 0;                                       // Tamaño de la copia compacta (los intervalos uno tras otro)
+};
+
+struct ConfiguracionBusqueda {
+    int maxOperaciones = 2;                 // Operaciones por etapa
+    long long maxNodos = 1000000;           // Secuencias evaluadas en total
+    long long maxMilisegundos = 10000;      // Tiempo total de la búsqueda
+};
+
+enum EstadoBusqueda { BUSQUEDA_ENCONTRADA, BUSQUEDA_AGOTADA, BUSQUEDA_SIN_PRESUPUESTO };
+
+struct ResultadoBusqueda {
+    EstadoBusqueda estado;
+    std::vector<std::vector<Operacion>> secuencias;     // Una secuencia por etapa, en el orden de 'etapas'
+    long long nodos;
+    long long milisegundos;
+};
+
+VentanasCaso calcularVentanas(std::span<const long long> semillas, size_t tamVentana, size_t totalBytes);
+ResultadoBusqueda buscarReconstruccion(const unsigned char* imagen, const unsigned char* IM, size_t totalBytes, size_t tamVentana, const EtapaBusqueda* etapas, int numEtapas, const ConfiguracionBusqueda& config);
+void aplicarSecuencia(const std::vector<Operacion>& secuencia, const unsigned char* origen, unsigned char* destino, const unsigned char* IM, size_t size);
+std::string nombreSecuencia(const std::vector<Operacion>& secuencia);
+
+#endif // BUSQUEDA_H
@@ -0,0 +1,579 @@
+/* Generador de casos sintéticos del Desafío 1
+ *
+ * Aplica hacia adelante el proceso que el programa principal revierte: parte de una imagen original I_O,
+ * enmascara (M0), y en cada etapa aplica una operación a nivel de bits sobre la imagen completa y vuelve a
+ * enmascarar (M1 ... MN). Escribe I_O.bmp (la solución), I_D.bmp, I_M.bmp, M.bmp, los archivos de
+ * enmascaramiento y Operaciones.txt con las operaciones de cada etapa en el mismo formato del informe de la
+ * reconstrucción. Sirve para medir tiempos y memoria con imágenes del tamaño de producción y para comprobar
+ * las rutas optimizadas contra una solución conocida.
+ *
+ * Las operaciones de las etapas se sortean (--ops) o se leen de una receta (--recipe), por ejemplo
+ *
+ *      xor; rotl 3; shr 2
+ *
+ * donde ';' o un salto de línea separa las etapas, ',' separa las operaciones de una etapa compuesta
+ * (xor, rotl 3) y '#' empieza un comentario. Las etapas no se aplican una por una: los enmascaramientos se
+ * calculan solo sobre sus ventanas y la imagen completa se transforma una sola vez con la cadena de todas las
+ * operaciones compuesta en tablas (CadenaOperaciones).
+ *
+ * Uso: Generador --out dir [--size WxH] [--stages N] [--mask WxH] [--seed N] [--ops xor:1,rotl:1,rotr:1,shl:0,shr:0]
+ *                 [--recipe archivo] [--input I_O.bmp] [--binary] [--threads N]
+ */
+
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "archivos.h"
+#include "imagenes.h"
+#include "operaciones.h"
+#include "paralelo.h"
+
+using namespace std;
+
+/* ******************************* Declaración de funnciones ******************************* */
+
+// Peso de cada tipo de operación al sortear la transformación de una etapa
+struct DistribucionOperaciones {
+    double pesos[5] = {1, 1, 1, 0, 0};      // En el orden de TipoOperacion: XOR, rotación izq., rotación der., desplazamiento izq., desplazamiento der.
+};
+
+bool leerDimensiones(const char* texto, int& ancho, int& alto);
+bool leerDistribucion(const char* texto, DistribucionOperaciones& distribucion);
+bool leerReceta(const string& ruta, vector<vector<Operacion>>& receta, string& error);
+Operacion sortearOperacion(mt19937_64& generador, const DistribucionOperaciones& distribucion);
+Operacion operacionInversa(Operacion op);
+void llenarAleatorio(mt19937_64& generador, unsigned char* datos, size_t bytes);
+string nombreEtapa(const vector<Operacion>& etapa);
+bool escribirEnmascaramiento(const string& base, int etapa, const unsigned char* ventana, const unsigned char* M, int wM, int hM, long long semilla, bool binario);
+
+
+/* ********************************************* Función Principal ************************************************ */
+
+int main(int argc, char* argv[])
+{
+    string directorio;
+    string entrada;
+
+    int ancho = 225;
+    int alto = 225;
+    int wM = 10;
+    int hM = 10;
+    int etapas = 3;
+    unsigned long long semillaAleatoria = 1;
+    int cantidadHilos = 0;
+    bool binario = false;
+
+    DistribucionOperaciones distribucion;
+
+    // Operaciones de cada etapa leídas de --recipe (vacío: se sortean)
+    vector<vector<Operacion>> receta;
+
+    for (int a=1;a<argc;a++){
+
+        string opcion = argv[a];
+
+        if (opcion=="--out" && a+1<argc){
+            directorio = argv[++a];
+        }
+
+        else if (opcion=="--size" && a+1<argc){
+            if (!leerDimensiones(argv[++a], ancho, alto)){
+                cout<<"--size espera ANCHOxALTO, por ejemplo 10000x10000"<<endl;
+                return 1;
+            }
+        }
+
+        else if (opcion=="--mask" && a+1<argc){
+            if (!leerDimensiones(argv[++a], wM, hM)){
+                cout<<"--mask espera ANCHOxALTO, por ejemplo 40x40"<<endl;
+                return 1;
+            }
+        }
+
+        else if (opcion=="--stages" && a+1<argc){
+            etapas = atoi(argv[++a]);
+        }
+
+        else if (opcion=="--seed" && a+1<argc){
+            semillaAleatoria = strtoull(argv[++a], nullptr, 10);
+        }
+
+        else if (opcion=="--ops" && a+1<argc){
+            if (!leerDistribucion(argv[++a], distribucion)){
+                cout<<"--ops espera tipo:peso separados por comas (xor, rotl, rotr, shl, shr), con algun peso positivo"<<endl;
+                return 1;
+            }
+        }
+
+        else if (opcion=="--recipe" && a+1<argc){
+
+            string error;
+
+            if (!leerReceta(argv[++a], receta, error)){
+                cout<<error<<endl;
+                return 1;
+            }
+
+        }
+
+        else if (opcion=="--input" && a+1<argc){
+            entrada = argv[++a];
+        }
+
+        // Escribe M*.bin (sumas) en lugar de M*.txt; con imágenes grandes el texto ocupa varias veces más
+        else if (opcion=="--binary"){
+            binario = true;
+        }
+
+        else if (opcion=="--threads" && a+1<argc){
+            cantidadHilos = atoi(argv[++a]);
+        }
+
+        else{
+            cout<<"Opcion desconocida: "<<opcion<<endl;
+            return 1;
+        }
+
+    }
+
+    // Con --recipe la cantidad de etapas es la de la receta
+    if (!receta.empty()){
+        etapas = (int)receta.size();
+    }
+
+    if (directorio.empty() || etapas < 0){
+        cout<<"Uso: "<<argv[0]<<" --out dir [--size WxH] [--stages N] [--mask WxH] [--seed N] [--ops xor:1,rotl:1,rotr:1,shl:0,shr:0] [--recipe archivo] [--input I_O.bmp] [--binary] [--threads N]"<<endl;
+        return 1;
+    }
+
+    // El directorio de salida se crea si no existe
+    error_code errorDirectorio;
+    filesystem::create_directories(directorio, errorDirectorio);
+
+    if (errorDirectorio){
+        cout<<"No se pudo crear "<<directorio<<": "<<errorDirectorio.message()<<endl;
+        return 1;
+    }
+
+    if (directorio.back() != '/' && directorio.back() != '\\'){
+        directorio += '/';
+    }
+
+    mt19937_64 generador(semillaAleatoria);
+
+    // Imagen original: la de --input o ruido uniforme
+    ImagenRgb imagen;
+    string error;
+
+    if (!entrada.empty()){
+
+        if (!cargarRgb(entrada.c_str(), imagen, error)){
+            cout<<error<<endl;
+            return 1;
+        }
+
+        ancho = imagen.ancho;
+        alto = imagen.alto;
+
+    }
+    else{
+
+        imagen.ancho = ancho;
+        imagen.alto = alto;
+        imagen.pixeles = poolBuffers().obtener((size_t)ancho * alto * 3);
+        llenarAleatorio(generador, imagen.pixeles.data(), imagen.pixeles.size());
+
+    }
+
+    size_t totalBytes = imagen.pixeles.size();
+    size_t tamVentana = (size_t)wM * hM * 3;
+
+    // La ventana de enmascaramiento debe caber en la imagen
+    if (tamVentana == 0 || tamVentana > totalBytes){
+        cout<<"La mascara ("<<wM<<"x"<<hM<<") no cabe en la imagen ("<<ancho<<"x"<<alto<<")."<<endl;
+        return 1;
+    }
+
+    vector<unsigned char> IM(totalBytes);
+    vector<unsigned char> M(tamVentana);
+
+    llenarAleatorio(generador, IM.data(), IM.size());
+    llenarAleatorio(generador, M.data(), M.size());
+
+    // Las imágenes se escriben en un hilo aparte mientras se transforman las etapas
+    EscritorImagenes escritor;
+    PoolHilos pool(cantidadHilos);
+
+    escritor.encolar(directorio + "I_O.bmp", imagen.pixeles.data(), ancho, alto);
+    escritor.encolar(directorio + "I_M.bmp", IM.data(), ancho, alto);
+    escritor.encolar(directorio + "M.bmp", M.data(), wM, hM);
+
+    ostringstream operaciones;
+    uniform_int_distribution<size_t> sorteoSemilla(0, totalBytes - tamVentana);
+
+    // Operaciones y semillas de todas las etapas, sorteadas en el mismo orden en que se aplicarían una por una
+    vector<long long> semillas;
+
+    for (int etapa = 0; etapa <= etapas; etapa++) {
+
+        if (etapa > 0 && (int)receta.size() < etapa){
+            receta.push_back({sortearOperacion(generador, distribucion)});
+        }
+
+        semillas.push_back((long long)sorteoSemilla(generador));
+
+    }
+
+    // Cada enmascaramiento solo necesita la ventana de la imagen en su etapa: se le aplican a esa ventana las
+    // operaciones de las etapas anteriores, sin tocar la imagen completa
+    CadenaOperaciones cadena;
+    vector<unsigned char> ventana(tamVentana);
+
+    for (int etapa = 0; etapa <= etapas; etapa++) {
+
+        // La etapa 0 solo enmascara la imagen original
+        if (etapa > 0){
+
+            for (const Operacion& op : receta[etapa - 1]) {
+                agregarOperacion(cadena, op);
+            }
+
+            // Se anota con el nombre que usa el informe de la reconstrucción para esta etapa
+            operaciones<<nombreEtapa(receta[etapa - 1])<<" en la etapa: "<<etapa<<endl;
+
+        }
+
+        memcpy(ventana.data(), imagen.pixeles.data() + semillas[etapa], tamVentana);
+        aplicarCadena(cadena, ventana.data(), IM.data() + semillas[etapa], tamVentana);
+
+        if (!escribirEnmascaramiento(directorio, etapa, ventana.data(), M.data(), wM, hM, semillas[etapa], binario)){
+            return 1;
+        }
+
+    }
+
+    // Una sola pasada por la imagen con todas las etapas compuestas
+    auto inicio = chrono::steady_clock::now();
+
+    aplicarCadenaEnFranjas(pool, cadena, imagen.pixeles.data(), IM.data(), totalBytes, (size_t)ancho * 3);
+
+    double segundosCodificacion = chrono::duration<double>(chrono::steady_clock::now() - inicio).count();
+
+    escritor.encolar(directorio + "I_D.bmp", imagen.pixeles.data(), ancho, alto);
+
+    FILE* archivo = fopen((directorio + "Operaciones.txt").c_str(), "w");
+
+    if (archivo == nullptr){
+        cout<<"No se pudo escribir "<<directorio<<"Operaciones.txt"<<endl;
+        return 1;
+    }
+
+    fputs(operaciones.str().c_str(), archivo);
+    fclose(archivo);
+
+    vector<string> erroresEscritura;
+
+    if (!escritor.esperar(erroresEscritura)){
+
+        for (const string& mensaje : erroresEscritura) {
+            cout<<"Error: No se pudo guardar la imagen BMP ("<<mensaje<<")."<<endl;
+        }
+
+        return 1;
+
+    }
+
+    cout<<directorio<<": "<<ancho<<"x"<<alto<<", mascara "<<wM<<"x"<<hM<<", "<<etapas<<" etapas ("<<etapas + 1<<" archivos de enmascaramiento)"<<endl;
+    cout<<operaciones.str();
+    cout<<"Codificacion: "<<segundosCodificacion * 1000<<" ms ("<<totalBytes / max(segundosCodificacion, 1e-9) / 1e9<<" GB/s, "<<cadena.tablas.size() - 1<<" XOR en la cadena)"<<endl;
+
+    return 0;
+}
+
+
+/* ************************************************** Funiciones *********************************************************** */
+
+bool leerDimensiones(const char* texto, int& ancho, int& alto){
+
+    // ANCHOxALTO con ambos valores positivos
+    return sscanf(texto, "%dx%d", &ancho, &alto) == 2 && ancho > 0 && alto > 0;
+
+}
+
+bool leerDistribucion(const char* texto, DistribucionOperaciones& distribucion){
+    /*
+ * @brief Lee los pesos de --ops, por ejemplo "xor:2,rotl:1,rotr:1,shl:0,shr:0".
+ *
+ * Los tipos que no aparecen quedan con peso 0.
+ *
+ * @return false si algún tipo no existe, algún peso es negativo o todos son 0.
+ */
+
+    const char* nombres[5] = {"xor", "rotl", "rotr", "shl", "shr"};
+    DistribucionOperaciones leida;
+    double total = 0;
+
+    for (double& peso : leida.pesos) {
+        peso = 0;
+    }
+
+    stringstream lista(texto);
+    string elemento;
+
+    while (getline(lista, elemento, ',')) {
+
+        size_t separador = elemento.find(':');
+        string nombre = elemento.substr(0, separador);
+        double peso = (separador == string::npos) ? 1 : atof(elemento.c_str() + separador + 1);
+        int tipo = -1;
+
+        for (int t = 0; t < 5; t++) {
+            if (nombre == nombres[t]) tipo = t;
+        }
+
+        if (tipo < 0 || peso < 0){
+            return false;
+        }
+
+        leida.pesos[tipo] = peso;
+
+    }
+
+    for (double peso : leida.pesos) {
+        total += peso;
+    }
+
+    if (total <= 0){
+        return false;
+    }
+
+    distribucion = leida;
+
+    return true;
+
+}
+
+bool leerReceta(const string& ruta, vector<vector<Operacion>>& receta, string& error){
+    /*
+ * @brief Lee una receta de --recipe: "xor; rotl 3, shr 2" son dos etapas, la segunda compuesta de dos operaciones.
+ *
+ * Las operaciones son xor, rotl N, rotr N, shl N y shr N con 1 ≤ N ≤ 8, las mismas de operacionXor,
+ * rotacionIzq, rotacionDer, desplazamientoIzq y desplazamientoDer aplicadas hacia adelante.
+ *
+ * @return false si el archivo no se puede leer, alguna operación no existe o no hay ninguna etapa.
+ */
+
+    ifstream archivo(ruta);
+
+    if (!archivo.is_open()){
+        error = "No se pudo abrir la receta " + ruta;
+        return false;
+    }
+
+    const char* nombres[5] = {"xor", "rotl", "rotr", "shl", "shr"};
+    string texto;
+    string linea;
+
+    // Los comentarios se descartan y los saltos de línea separan etapas igual que ';'
+    while (getline(archivo, linea)) {
+        texto += linea.substr(0, linea.find('#')) + ';';
+    }
+
+    receta.clear();
+
+    stringstream etapas(texto);
+    string etapa;
+
+    while (getline(etapas, etapa, ';')) {
+
+        stringstream pasos(etapa);
+        string paso;
+        vector<Operacion> operaciones;
+
+        while (getline(pasos, paso, ',')) {
+
+            stringstream palabras(paso);
+            string nombre;
+            string sobrante;
+            int bits = 0;
+
+            if (!(palabras >> nombre)){
+                continue;
+            }
+
+            int tipo = -1;
+
+            for (int t = 0; t < 5; t++) {
+                if (nombre == nombres[t]) tipo = t;
+            }
+
+            // La XOR no lleva bits; las demás, entre 1 y 8
+            bool valida = (tipo == OP_XOR) || (tipo > 0 && (palabras >> bits) && bits >= 1 && bits <= 8);
+
+            if (!valida || (palabras >> sobrante)){
+                error = ruta + ": operacion invalida \"" + paso + "\" (se espera xor, rotl N, rotr N, shl N o shr N con N de 1 a 8)";
+                return false;
+            }
+
+            operaciones.push_back({(TipoOperacion)tipo, bits});
+
+        }
+
+        if (!operaciones.empty()){
+            receta.push_back(operaciones);
+        }
+
+    }
+
+    if (receta.empty()){
+        error = ruta + ": la receta no tiene etapas";
+        return false;
+    }
+
+    return true;
+
+}
+
+Operacion sortearOperacion(mt19937_64& generador, const DistribucionOperaciones& distribucion){
+    /*
+ * @brief Sortea la transformación de una etapa según los pesos y, si rota o desplaza, la cantidad de bits.
+ *
+ * Los bits van de 1 a 7: rotar 8 bits no cambia la imagen y desplazar 8 la deja en cero.
+ */
+
+    discrete_distribution<int> sorteoTipo(begin(distribucion.pesos), end(distribucion.pesos));
+    uniform_int_distribution<int> sorteoBits(1, 7);
+
+    Operacion op;
+    op.tipo = (TipoOperacion)sorteoTipo(generador);
+    op.bits = (op.tipo == OP_XOR) ? 0 : sorteoBits(generador);
+
+    return op;
+
+}
+
+Operacion operacionInversa(Operacion op){
+
+    // Las rotaciones y desplazamientos se revierten con el sentido contrario; la XOR con ella misma
+    switch (op.tipo) {
+    case OP_ROTACION_IZQ:       return {OP_ROTACION_DER, op.bits};
+    case OP_ROTACION_DER:       return {OP_ROTACION_IZQ, op.bits};
+    case OP_DESPLAZAMIENTO_IZQ: return {OP_DESPLAZAMIENTO_DER, op.bits};
+    case OP_DESPLAZAMIENTO_DER: return {OP_DESPLAZAMIENTO_IZQ, op.bits};
+    default:                    return op;
+    }
+
+}
+
+string nombreEtapa(const vector<Operacion>& etapa){
+
+    // Las operaciones que revierten una etapa compuesta van en el orden inverso, como en el informe de la reconstrucción
+    if (etapa.size() == 1){
+        return nombreOperacion(operacionInversa(etapa[0]));
+    }
+
+    string nombre = "Etapa compuesta: ";
+
+    for (size_t i = etapa.size(); i-- > 0; ) {
+        nombre += nombreOperacion(operacionInversa(etapa[i]));
+        if (i > 0) nombre += ", luego ";
+    }
+
+    return nombre;
+
+}
+
+void llenarAleatorio(mt19937_64& generador, unsigned char* datos, size_t bytes){
+
+    // Ocho bytes por cada número del generador
+    size_t k = 0;
+
+    for (; k + 8 <= bytes; k += 8) {
+        uint64_t valor = generador();
+        memcpy(datos + k, &valor, 8);
+    }
+
+    uint64_t valor = generador();
+
+    for (; k < bytes; k++, valor >>= 8) {
+        datos[k] = (unsigned char)valor;
+    }
+
+}
+
+bool escribirEnmascaramiento(const string& base, int etapa, const unsigned char* ventana, const unsigned char* M, int wM, int hM, long long semilla, bool binario){
+    /*
+ * @brief Calcula S(k) = ID(k + s) + M(k) para 0 ≤ k < i × j × 3 y lo guarda como M{etapa}.txt o M{etapa}.bin.
+ *
+ * El texto tiene el mismo formato que los archivos de enmascaramiento originales: la semilla en la primera
+ * línea y un triplete R G B por línea.
+ *
+ * @param ventana Bytes ID(s) ... ID(s + i × j × 3 - 1) de la imagen en esta etapa.
+ */
+
+    size_t tamVentana = (size_t)wM * hM * 3;
+    string ruta = base + "M" + to_string(etapa) + (binario ? ".bin" : ".txt");
+    string error;
+
+    if (binario){
+
+        DatosEnmascaramiento datos;
+        datos.semilla = semilla;
+        datos.sumas.resize(tamVentana);
+
+        for (size_t k = 0; k < tamVentana; k++) {
+            datos.sumas[k] = (uint16_t)(ventana[k] + M[k]);
+        }
+
+        if (!escribirEnmascaramientoBinario(ruta.c_str(), datos, M, wM, hM, false, error)){
+            cout<<error<<endl;
+            return false;
+        }
+
+        return true;
+
+    }
+
+    // Como mucho "510 510 510\n" por píxel
+    vector<char> texto(32 + tamVentana / 3 * 12);
+    char* p = texto.data();
+
+    p = to_chars(p, p + 24, semilla).ptr;
+    *p++ = '\n';
+
+    for (size_t k = 0; k < tamVentana; k += 3) {
+
+        for (int c = 0; c < 3; c++) {
+            p = to_chars(p, p + 3, ventana[k + c] + M[k + c]).ptr;
+            *p++ = (c < 2) ? ' ' : '\n';
+        }
+
+    }
+
+    FILE* archivo = fopen(ruta.c_str(), "wb");
+
+    if (archivo == nullptr){
+        cout<<"No se pudo escribir "<<ruta<<endl;
+        return false;
+    }
+
+    bool escrito = fwrite(texto.data(), 1, (size_t)(p - texto.data()), archivo) == (size_t)(p - texto.data());
+    escrito = (fclose(archivo) == 0) && escrito;
+
+    if (!escrito){
+        cout<<"No se pudo escribir "<<ruta<<endl;
+    }
+
+    return escrito;
+
+}
@@ -0,0 +1,1046 @@
+#include "imagenes.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+
+/* ************************************************** Lectura *********************************************************** */
+
+// Los campos del BMP están en little-endian y no necesariamente alineados
+static uint32_t leer32(const unsigned char* p){
+
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+
+}
+
+static uint16_t leer16(const unsigned char* p){
+
+    return (uint16_t)(p[0] | (p[1] << 8));
+
+}
+
+bool ImagenBmp::abrir(const char* ruta, string& error){
+    /*
+ * @brief Abre un archivo BMP sin compresión y deja una vista de sus píxeles sobre la proyección en memoria.
+ *
+ * No se copia ningún píxel: la vista apunta a la fila superior de la imagen y avanza con un paso con signo,
+ * así que un archivo guardado de abajo hacia arriba (alto positivo en la cabecera) se recorre igual que uno
+ * guardado de arriba hacia abajo.
+ *
+ * @param ruta Ruta del archivo .bmp.
+ * @param error Mensaje si el archivo no existe, está truncado o usa un formato no soportado.
+ *
+ * @return true si la vista quedó lista.
+ */
+
+    datos = VistaBmp();
+
+    if (!archivo.abrir(ruta)) {
+        error = string("No se pudo abrir la imagen ") + ruta;
+        return false;
+    }
+
+    return leerVistaBmp(archivo.datos(), archivo.tamano(), ruta, datos, error);
+
+}
+
+bool leerCabeceraBmp(const unsigned char* p, size_t disponibles, size_t tamArchivo, const char* ruta, CabeceraBmp& cabecera, string& error){
+    /*
+ * @brief Interpreta las cabeceras de un BMP y comprueba que el archivo tenga todas sus filas.
+ *
+ * @param p Primeros bytes del archivo.
+ * @param disponibles Bytes leídos en p; deben alcanzar para las cabeceras y la paleta (hasta el inicio de los píxeles).
+ * @param tamArchivo Tamaño del archivo completo.
+ * @param ruta Nombre que se usa en los mensajes de error.
+ */
+
+    cabecera = CabeceraBmp();
+
+    // Cabecera de archivo (14 bytes) y cabecera BITMAPINFOHEADER o posterior (al menos 40 bytes)
+    if (disponibles < 54 || p[0] != 'B' || p[1] != 'M') {
+        error = string(ruta) + ": no es un archivo BMP";
+        return false;
+    }
+
+    uint32_t inicioPixeles = leer32(p + 10);
+    uint32_t tamCabecera = leer32(p + 14);
+    int32_t ancho = (int32_t)leer32(p + 18);
+    int32_t alto = (int32_t)leer32(p + 22);
+    uint16_t bits = leer16(p + 28);
+    uint32_t compresion = leer32(p + 30);
+    uint32_t coloresUsados = leer32(p + 46);
+
+    if (tamCabecera < 40 || compresion != 0 || (bits != 24 && bits != 32 && bits != 8)) {
+        error = string(ruta) + ": formato BMP no soportado (solo 8, 24 o 32 bits sin compresion)";
+        return false;
+    }
+
+    // Un alto negativo indica que las filas están de arriba hacia abajo
+    bool deArribaHaciaAbajo = (alto < 0);
+
+    if (deArribaHaciaAbajo) {
+        alto = -alto;
+    }
+
+    if (ancho <= 0 || alto <= 0) {
+        error = string(ruta) + ": dimensiones invalidas";
+        return false;
+    }
+
+    // Cada fila ocupa un múltiplo de 4 bytes
+    size_t bytesFila = ((size_t)ancho * bits + 31) / 32 * 4;
+
+    if (inicioPixeles > tamArchivo || bytesFila * (size_t)alto > tamArchivo - inicioPixeles) {
+        error = string(ruta) + ": el archivo esta truncado";
+        return false;
+    }
+
+    if (bits == 8) {
+
+        size_t colores = (coloresUsados == 0 || coloresUsados > 256) ? 256 : coloresUsados;
+        size_t inicioPaleta = 14 + (size_t)tamCabecera;
+
+        // La paleta puede tener menos entradas que 256 aunque la cabecera no lo diga
+        if (inicioPaleta > inicioPixeles || inicioPixeles > disponibles) {
+            error = string(ruta) + ": el archivo esta truncado";
+            return false;
+        }
+
+        cabecera.inicioPaleta = inicioPaleta;
+        cabecera.coloresPaleta = (int)min(colores, (inicioPixeles - inicioPaleta) / 4);
+
+    }
+
+    cabecera.inicioPixeles = inicioPixeles;
+    cabecera.bytesFila = bytesFila;
+    cabecera.ancho = ancho;
+    cabecera.alto = alto;
+    cabecera.bitsPorPixel = bits;
+    cabecera.deArribaHaciaAbajo = deArribaHaciaAbajo;
+
+    return true;
+
+}
+
+bool leerVistaBmp(const unsigned char* p, size_t tam, const char* ruta, VistaBmp& vista, string& error){
+    /*
+ * @brief Interpreta el contenido de un archivo BMP que ya está en memoria; la vista apunta a 'p' sin copiar nada.
+ *
+ * @param ruta Nombre que se usa en los mensajes de error.
+ */
+
+    vista = VistaBmp();
+
+    CabeceraBmp cabecera;
+
+    if (!leerCabeceraBmp(p, tam, tam, ruta, cabecera, error)) {
+        return false;
+    }
+
+    const unsigned char* pixeles = p + cabecera.inicioPixeles;
+
+    vista.ancho = cabecera.ancho;
+    vista.alto = cabecera.alto;
+    vista.bitsPorPixel = cabecera.bitsPorPixel;
+
+    if (cabecera.bitsPorPixel == 8) {
+        vista.paleta = p + cabecera.inicioPaleta;
+        vista.coloresPaleta = cabecera.coloresPaleta;
+    }
+
+    if (cabecera.deArribaHaciaAbajo) {
+        vista.primeraFila = pixeles;
+        vista.pasoFila = (ptrdiff_t)cabecera.bytesFila;
+    }
+    else {
+        vista.primeraFila = pixeles + cabecera.bytesFila * (size_t)(cabecera.alto - 1);
+        vista.pasoFila = -(ptrdiff_t)cabecera.bytesFila;
+    }
+
+    return true;
+
+}
+
+void copiarRgb(const VistaBmp& vista, unsigned char* destino){
+
+    size_t bytesSalida = (size_t)vista.ancho * 3;
+
+    for (int y = 0; y < vista.alto; y++) {
+
+        const unsigned char* origen = vista.fila(y);
+        unsigned char* fila = destino + bytesSalida * y;
+
+        if (vista.bitsPorPixel == 8) {
+
+            for (int x = 0; x < vista.ancho; x++) {
+
+                // Un índice fuera de la paleta se toma como negro
+                const unsigned char* color = (origen[x] < vista.coloresPaleta) ? vista.paleta + 4 * origen[x] : nullptr;
+
+                fila[3 * x]     = color ? color[2] : 0;
+                fila[3 * x + 1] = color ? color[1] : 0;
+                fila[3 * x + 2] = color ? color[0] : 0;
+
+            }
+
+        }
+        else {
+
+            int bytesPixel = vista.bitsPorPixel / 8;
+
+            for (int x = 0; x < vista.ancho; x++) {
+
+                const unsigned char* bgr = origen + bytesPixel * x;
+
+                fila[3 * x]     = bgr[2];
+                fila[3 * x + 1] = bgr[1];
+                fila[3 * x + 2] = bgr[0];
+
+            }
+
+        }
+
+    }
+
+}
+
+bool cargarRgb(const char* ruta, ImagenRgb& imagen, string& error){
+
+    ImagenBmp bmp;
+
+    if (!bmp.abrir(ruta, error)) {
+        return false;
+    }
+
+    imagen.ancho = bmp.vista().ancho;
+    imagen.alto = bmp.vista().alto;
+    imagen.pixeles = poolBuffers().obtener((size_t)imagen.ancho * 3 * imagen.alto);
+
+    copiarRgb(bmp.vista(), imagen.pixeles.data());
+
+    return true;
+
+}
+
+bool cargarRgb(const unsigned char* datos, size_t tam, const char* nombre, ImagenRgb& imagen, string& error){
+
+    VistaBmp vista;
+
+    if (!leerVistaBmp(datos, tam, nombre, vista, error)) {
+        return false;
+    }
+
+    imagen.ancho = vista.ancho;
+    imagen.alto = vista.alto;
+    imagen.pixeles = poolBuffers().obtener((size_t)imagen.ancho * 3 * imagen.alto);
+
+    copiarRgb(vista, imagen.pixeles.data());
+
+    return true;
+
+}
+
+
+/* ************************************************** Caché de imágenes *********************************************************** */
+
+// Hash de 128 bits del contenido recibido, de a 16 bytes por vuelta en dos cadenas de multiplicaciones independientes
+// (varios GB/s, contra los cientos de MB/s de FNV-1a byte a byte). Solo ubica la entrada: el acierto se confirma
+// comparando los bytes, así que no necesita resistir colisiones buscadas
+static string claveContenido(const unsigned char* datos, size_t tam){
+
+    uint64_t a = 0x9E3779B97F4A7C15ULL ^ (uint64_t)tam;
+    uint64_t b = 0xC2B2AE3D27D4EB4FULL;
+    size_t i = 0;
+
+    for (; i + 16 <= tam; i += 16) {
+
+        uint64_t x, y;
+        memcpy(&x, datos + i, 8);
+        memcpy(&y, datos + i + 8, 8);
+
+        a = (a ^ x) * 0xFF51AFD7ED558CCDULL;
+        a ^= a >> 32;
+        b = (b ^ y) * 0xC4CEB9FE1A85EC53ULL;
+        b ^= b >> 29;
+
+    }
+
+    uint64_t resto[2] = {0, 0};
+    memcpy(resto, datos + i, tam - i);
+
+    a = (a ^ resto[0] ^ (b >> 17)) * 0xFF51AFD7ED558CCDULL;
+    b = (b ^ resto[1] ^ (a >> 23)) * 0xC4CEB9FE1A85EC53ULL;
+    a ^= a >> 33;
+    b ^= b >> 33;
+
+    char texto[64];
+    snprintf(texto, sizeof(texto), "contenido:%016llx%016llx:%zu", (unsigned long long)a, (unsigned long long)b, tam);
+
+    return texto;
+
+}
+
+// Identidad de un archivo en disco: ruta absoluta, inodo, tamaño y fecha de modificación. Un archivo reemplazado o
+// modificado cambia de clave y se vuelve a decodificar
+static bool claveArchivo(const string& ruta, string& clave){
+
+    error_code fallo;
+    filesystem::path absoluta = filesystem::absolute(ruta, fallo).lexically_normal();
+
+    if (fallo) {
+        return false;
+    }
+
+    uintmax_t tam = filesystem::file_size(absoluta, fallo);
+
+    if (fallo) {
+        return false;
+    }
+
+    filesystem::file_time_type modificado = filesystem::last_write_time(absoluta, fallo);
+
+    if (fallo) {
+        return false;
+    }
+
+    clave = "archivo:" + absoluta.string() + ":" + to_string(tam) + ":" + to_string((long long)modificado.time_since_epoch().count());
+
+#ifndef _WIN32
+    struct stat datos;
+
+    if (stat(absoluta.c_str(), &datos) == 0) {
+        clave += ":" + to_string((unsigned long long)datos.st_dev) + ":" + to_string((unsigned long long)datos.st_ino);
+    }
+#endif
+
+    return true;
+
+}
+
+CacheImagenes::CacheImagenes(size_t capacidad)
+    : capacidad(capacidad){}
+
+shared_ptr<const ImagenRgb> CacheImagenes::buscar(const string& clave, const unsigned char* datos, size_t tam, bool& colision){
+    /*
+ * @brief Busca una clave; si la entrada guarda el contenido recibido, el acierto se confirma comparándolo con 'datos'.
+ *
+ * La comparación se hace fuera del candado (el contenido es compartido), así que otros hilos pueden seguir usando
+ * la caché mientras tanto.
+ *
+ * @param colision Recibe true si la clave existe pero el contenido es otro.
+ */
+
+    colision = false;
+
+    shared_ptr<const ImagenRgb> imagen;
+    shared_ptr<const vector<unsigned char>> contenido;
+
+    {
+        lock_guard<mutex> guardia(candado);
+        auto encontrada = imagenes.find(clave);
+
+        if (encontrada == imagenes.end()) {
+            return nullptr;
+        }
+
+        imagen = encontrada->second.imagen;
+        contenido = encontrada->second.contenido;
+    }
+
+    if (contenido && (contenido->size() != tam || memcmp(contenido->data(), datos, tam) != 0)) {
+        colision = true;
+        return nullptr;
+    }
+
+    lock_guard<mutex> guardia(candado);
+    auto encontrada = imagenes.find(clave);
+
+    // Pasa al frente de la lista de usos (si otro hilo no la sacó mientras tanto)
+    if (encontrada != imagenes.end() && encontrada->second.imagen == imagen) {
+        usos.splice(usos.begin(), usos, encontrada->second.uso);
+    }
+
+    aciertos++;
+
+    return imagen;
+
+}
+
+shared_ptr<const ImagenRgb> CacheImagenes::guardar(const string& clave, shared_ptr<const ImagenRgb> imagen, shared_ptr<const vector<unsigned char>> contenido){
+    /*
+ * @brief Agrega una imagen recién decodificada y, si hace falta lugar, saca la usada hace más tiempo.
+ *
+ * Si otro hilo ya agregó la misma clave se conserva la suya. Las imágenes sacadas siguen vivas mientras algún
+ * caso tenga su shared_ptr.
+ */
+
+    lock_guard<mutex> guardia(candado);
+    auto encontrada = imagenes.find(clave);
+
+    if (encontrada != imagenes.end()) {
+        usos.splice(usos.begin(), usos, encontrada->second.uso);
+        return encontrada->second.imagen;
+    }
+
+    usos.push_front(clave);
+    imagenes.emplace(clave, Entrada{imagen, contenido, usos.begin()});
+
+    while (capacidad > 0 && imagenes.size() > capacidad) {
+        imagenes.erase(usos.back());
+        usos.pop_back();
+        desalojos++;
+    }
+
+    return imagen;
+
+}
+
+shared_ptr<const ImagenRgb> CacheImagenes::obtener(const string& ruta, string& error){
+    /*
+ * @brief Devuelve la imagen de un archivo, decodificándola solo si el mismo archivo, sin modificar, ya está en la caché.
+ *
+ * La clave es la identidad del archivo (ruta, inodo, tamaño y fecha de modificación), que se consulta sin leer su
+ * contenido: un acierto no recorre el archivo. Se puede llamar desde varios hilos; si dos hilos piden a la vez una
+ * imagen nueva, ambos la decodifican y se conserva la primera.
+ *
+ * @return La imagen, o nullptr (con el error) si no se pudo cargar.
+ */
+
+    string clave;
+    bool colision;
+
+    if (!claveArchivo(ruta, clave)) {
+        error = string("No se pudo abrir la imagen ") + ruta;
+        return nullptr;
+    }
+
+    shared_ptr<const ImagenRgb> encontrada = buscar(clave, nullptr, 0, colision);
+
+    if (encontrada) {
+        return encontrada;
+    }
+
+    shared_ptr<ImagenRgb> imagen = make_shared<ImagenRgb>();
+
+    if (!cargarRgb(ruta.c_str(), *imagen, error)) {
+        return nullptr;
+    }
+
+    return guardar(clave, imagen, nullptr);
+
+}
+
+shared_ptr<const ImagenRgb> CacheImagenes::obtener(const unsigned char* datos, size_t tam, const char* nombre, string& error){
+    /*
+ * @brief Igual que la versión con ruta, pero con el contenido del BMP ya en memoria (por ejemplo, recibido por un socket).
+ *
+ * La clave es un hash rápido del contenido y la entrada conserva una copia de los bytes: un acierto solo se acepta
+ * si el contenido es idéntico, así que un cliente no puede hacer que se use la imagen de otro pedido. Si dos
+ * contenidos distintos tienen la misma clave, el nuevo se decodifica sin guardarlo.
+ */
+
+    string clave = claveContenido(datos, tam);
+    bool colision;
+    shared_ptr<const ImagenRgb> encontrada = buscar(clave, datos, tam, colision);
+
+    if (encontrada) {
+        return encontrada;
+    }
+
+    shared_ptr<ImagenRgb> imagen = make_shared<ImagenRgb>();
+
+    if (!cargarRgb(datos, tam, nombre, *imagen, error)) {
+        return nullptr;
+    }
+
+    if (colision) {
+        return imagen;
+    }
+
+    return guardar(clave, imagen, make_shared<const vector<unsigned char>>(datos, datos + tam));
+
+}
+
+size_t CacheImagenes::cargadas() const{
+
+    lock_guard<mutex> guardia(candado);
+    return imagenes.size();
+
+}
+
+size_t CacheImagenes::descartadas() const{
+
+    lock_guard<mutex> guardia(candado);
+    return desalojos;
+
+}
+
+size_t CacheImagenes::reutilizadas() const{
+
+    lock_guard<mutex> guardia(candado);
+    return aciertos;
+
+}
+
+
+/* ************************************************** Escritura *********************************************************** */
+
+// Cabeceras de un BMP de 24 bits de abajo hacia arriba. bfSize y biSizeImage son de 32 bits: si el archivo no cabe
+// en ellos se escriben en 0 (válido para BI_RGB, donde el tamaño se deduce de las dimensiones) en lugar de truncarlos
+static void escribirCabeceraBmp(unsigned char p[54], int ancho, int alto){
+
+    size_t bytesPixeles = ((size_t)ancho * 3 + 3) / 4 * 4 * (size_t)alto;
+
+    memset(p, 0, 54);
+
+    auto escribir32 = [](unsigned char* destino, uint32_t valor){
+        for (int i = 0; i < 4; i++) destino[i] = (unsigned char)(valor >> (8 * i));
+    };
+
+    // BITMAPFILEHEADER + BITMAPINFOHEADER
+    p[0] = 'B';
+    p[1] = 'M';
+    bool tamanoCabe = (54 + bytesPixeles <= UINT32_MAX);
+
+    escribir32(p + 2, tamanoCabe ? (uint32_t)(54 + bytesPixeles) : 0);
+    escribir32(p + 10, 54);
+    escribir32(p + 14, 40);
+    escribir32(p + 18, (uint32_t)ancho);
+    escribir32(p + 22, (uint32_t)alto);
+    p[26] = 1;
+    p[28] = 24;
+    escribir32(p + 34, tamanoCabe ? (uint32_t)bytesPixeles : 0);
+    escribir32(p + 38, 2835);       // 72 ppp
+    escribir32(p + 42, 2835);
+
+}
+
+void codificarBmp(const unsigned char* rgb, int ancho, int alto, ImagenCodificada& imagen){
+    /*
+ * @brief Arma las cabeceras y las filas de un BMP de 24 bits (de abajo hacia arriba) a partir de un arreglo RGB888.
+ *
+ * Las filas se convierten a BGR con su relleno en un solo recorrido; es la única copia de la imagen antes de
+ * escribirla, y después de ella el arreglo original se puede seguir modificando.
+ */
+
+    size_t bytesFila = ((size_t)ancho * 3 + 3) / 4 * 4;
+    size_t bytesPixeles = bytesFila * (size_t)alto;
+
+    escribirCabeceraBmp(imagen.cabecera, ancho, alto);
+
+    // El buffer puede venir usado del pool: solo se escribe el relleno de cada fila, el resto se sobrescribe
+    imagen.pixeles = poolBuffers().obtener(bytesPixeles);
+
+    for (int y = 0; y < alto; y++) {
+
+        const unsigned char* origen = rgb + (size_t)ancho * 3 * y;
+        unsigned char* destino = imagen.pixeles.data() + bytesFila * (size_t)(alto - 1 - y);
+
+        for (int x = 0; x < ancho; x++) {
+            destino[3 * x]     = origen[3 * x + 2];
+            destino[3 * x + 1] = origen[3 * x + 1];
+            destino[3 * x + 2] = origen[3 * x];
+        }
+
+        memset(destino + (size_t)ancho * 3, 0, bytesFila - (size_t)ancho * 3);
+
+    }
+
+}
+
+bool escribirCodificada(const char* ruta, const ImagenCodificada& imagen, string& error){
+    /*
+ * @brief Escribe una imagen codificada: cabeceras y píxeles salen en una sola escritura vectorizada (writev).
+ *
+ * En Windows, sin writev, se usan dos fwrite sobre el mismo archivo.
+ */
+
+#ifdef _WIN32
+
+    FILE* salida = fopen(ruta, "wb");
+
+    if (salida == nullptr) {
+        error = string("No se pudo crear la imagen ") + ruta;
+        return false;
+    }
+
+    bool escrito = fwrite(imagen.cabecera, 1, sizeof(imagen.cabecera), salida) == sizeof(imagen.cabecera) &&
+                   fwrite(imagen.pixeles.data(), 1, imagen.pixeles.size(), salida) == imagen.pixeles.size();
+    escrito = (fclose(salida) == 0) && escrito;
+
+#else
+
+    int descriptor = open(ruta, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (descriptor < 0) {
+        error = string("No se pudo crear la imagen ") + ruta;
+        return false;
+    }
+
+    struct iovec partes[2];
+    partes[0].iov_base = (void*)imagen.cabecera;
+    partes[0].iov_len = sizeof(imagen.cabecera);
+    partes[1].iov_base = (void*)imagen.pixeles.data();
+    partes[1].iov_len = imagen.pixeles.size();
+
+    struct iovec* pendientes = partes;
+    int cantidad = 2;
+    bool escrito = true;
+
+    // writev puede escribir menos de lo pedido: se continúa desde donde quedó
+    while (cantidad > 0) {
+
+        ssize_t n = writev(descriptor, pendientes, cantidad);
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            escrito = false;
+            break;
+        }
+
+        while (cantidad > 0 && (size_t)n >= pendientes->iov_len) {
+            n -= (ssize_t)pendientes->iov_len;
+            pendientes++;
+            cantidad--;
+        }
+
+        if (cantidad > 0) {
+            pendientes->iov_base = (unsigned char*)pendientes->iov_base + n;
+            pendientes->iov_len -= (size_t)n;
+        }
+
+    }
+
+    escrito = (close(descriptor) == 0) && escrito;
+
+#endif
+
+    if (!escrito) {
+        error = string("No se pudo escribir la imagen ") + ruta;
+    }
+
+    return escrito;
+
+}
+
+bool escribirBmp(const char* ruta, const unsigned char* rgb, int ancho, int alto, string& error){
+    /*
+ * @brief Guarda un arreglo RGB888 sin relleno como BMP de 24 bits, en el hilo que llama.
+ *
+ * @param ruta Ruta del archivo de salida.
+ * @param rgb Píxeles R, G, B de la fila superior a la inferior.
+ * @param ancho Ancho en píxeles.
+ * @param alto Alto en píxeles.
+ * @param error Mensaje si no se pudo escribir.
+ */
+
+    if (rgb == nullptr || ancho <= 0 || alto <= 0) {
+        error = string(ruta) + ": imagen vacia";
+        return false;
+    }
+
+    ImagenCodificada imagen;
+    codificarBmp(rgb, ancho, alto, imagen);
+
+    return escribirCodificada(ruta, imagen, error);
+
+}
+
+
+/* ************************************************** Escritura en segundo plano *********************************************************** */
+
+EscritorImagenes::EscritorImagenes(size_t limiteBytes)
+    : limiteBytes(limiteBytes > 0 ? limiteBytes : 1){
+
+    hilo = thread(&EscritorImagenes::trabajar, this);
+
+}
+
+EscritorImagenes::~EscritorImagenes(){
+
+    {
+        lock_guard<mutex> guardia(candado);
+        terminar = true;
+    }
+
+    hayTrabajo.notify_all();
+    hilo.join();
+
+}
+
+bool EscritorImagenes::encolar(const string& ruta, const unsigned char* rgb, int ancho, int alto){
+    /*
+ * @brief Codifica la imagen en el hilo que llama y deja su escritura al hilo de fondo.
+ *
+ * Antes de codificar se reservan los bytes de la imagen codificada; si con ellos se pasa de limiteBytes se espera a
+ * que el hilo de fondo termine de escribir otras imágenes. Así la copia BGR con relleno no se arma hasta que hay
+ * lugar y la memoria pendiente queda acotada en bytes, no en cantidad de imágenes.
+ * Al volver, el arreglo rgb ya se puede modificar.
+ *
+ * @return false si la imagen está vacía (no se encola nada).
+ */
+
+    if (rgb == nullptr || ancho <= 0 || alto <= 0) {
+        lock_guard<mutex> guardia(candado);
+        errores.push_back(ruta + ": imagen vacia");
+        return false;
+    }
+
+    size_t bytes = ((size_t)ancho * 3 + 3) / 4 * 4 * (size_t)alto;
+
+    {
+        unique_lock<mutex> guardia(candado);
+        hayLugar.wait(guardia, [&]{ return bytesPendientes == 0 || bytesPendientes + bytes <= limiteBytes; });
+        bytesPendientes += bytes;
+    }
+
+    Trabajo trabajo;
+    trabajo.ruta = ruta;
+    trabajo.bytes = bytes;
+    codificarBmp(rgb, ancho, alto, trabajo.imagen);
+
+    {
+        lock_guard<mutex> guardia(candado);
+        cola.push_back(move(trabajo));
+    }
+
+    hayTrabajo.notify_one();
+
+    return true;
+
+}
+
+bool EscritorImagenes::esperar(vector<string>& mensajes){
+
+    unique_lock<mutex> guardia(candado);
+    vacia.wait(guardia, [this]{ return bytesPendientes == 0; });
+
+    mensajes.swap(errores);
+    errores.clear();
+
+    return mensajes.empty();
+
+}
+
+void EscritorImagenes::trabajar(){
+
+    while (true) {
+
+        Trabajo trabajo;
+
+        {
+            unique_lock<mutex> guardia(candado);
+            hayTrabajo.wait(guardia, [this]{ return terminar || !cola.empty(); });
+
+            // Al terminar se escriben primero las imágenes que quedaron en la cola
+            if (cola.empty()) {
+                return;
+            }
+
+            trabajo = move(cola.front());
+            cola.pop_front();
+        }
+
+        string error;
+        bool escrito = escribirCodificada(trabajo.ruta.c_str(), trabajo.imagen, error);
+
+        // Los píxeles vuelven a poolBuffers() antes de liberar su reserva
+        trabajo.imagen.pixeles = BufferAlineado();
+
+        {
+            lock_guard<mutex> guardia(candado);
+            bytesPendientes -= trabajo.bytes;
+            if (!escrito) errores.push_back(error);
+        }
+
+        hayLugar.notify_all();
+        vacia.notify_all();
+
+    }
+
+}
+
+
+/* ************************************************** Lectura y escritura por franjas *********************************************************** */
+
+// Posiciona un archivo en un desplazamiento de 64 bits (las imágenes de varios GB pasan de LONG_MAX en Windows)
+static bool posicionar(FILE* archivo, uint64_t posicion){
+
+#ifdef _WIN32
+    return _fseeki64(archivo, (long long)posicion, SEEK_SET) == 0;
+#else
+    return fseeko(archivo, (off_t)posicion, SEEK_SET) == 0;
+#endif
+
+}
+
+LectorFranjasBmp::~LectorFranjasBmp(){
+
+    if (archivo != nullptr) {
+        fclose(archivo);
+    }
+
+}
+
+bool LectorFranjasBmp::abrir(const char* ruta, string& error){
+    /*
+ * @brief Abre un BMP para leerlo de a varias filas, sin proyectarlo ni cargarlo completo.
+ *
+ * Solo se leen las cabeceras (y la paleta, si la hay); las filas se leen después con leerFilas.
+ */
+
+    if (archivo != nullptr) {
+        fclose(archivo);
+    }
+
+    nombre = ruta;
+    archivo = fopen(ruta, "rb");
+
+    if (archivo == nullptr) {
+        error = string("No se pudo abrir la imagen ") + ruta;
+        return false;
+    }
+
+    // Tamaño del archivo, para comprobar que tenga todas las filas
+    uint64_t tamArchivo = 0;
+
+#ifdef _WIN32
+    _fseeki64(archivo, 0, SEEK_END);
+    tamArchivo = (uint64_t)_ftelli64(archivo);
+#else
+    fseeko(archivo, 0, SEEK_END);
+    tamArchivo = (uint64_t)ftello(archivo);
+#endif
+
+    // Las cabeceras y la paleta ocupan hasta el inicio de los píxeles (campo de los bytes 10 a 13)
+    unsigned char inicio[14] = {};
+
+    if (!posicionar(archivo, 0) || fread(inicio, 1, sizeof(inicio), archivo) != sizeof(inicio)) {
+        error = string(ruta) + ": no es un archivo BMP";
+        return false;
+    }
+
+    size_t inicioPixeles = (size_t)inicio[10] | ((size_t)inicio[11] << 8) | ((size_t)inicio[12] << 16) | ((size_t)inicio[13] << 24);
+    size_t bytesCabeceras = min<size_t>(max<size_t>(inicioPixeles, 54), 1 << 16);
+
+    cabeceras.assign(bytesCabeceras, 0);
+
+    size_t leidos = 0;
+
+    if (posicionar(archivo, 0)) {
+        leidos = fread(cabeceras.data(), 1, bytesCabeceras, archivo);
+    }
+
+    return leerCabeceraBmp(cabeceras.data(), leidos, (size_t)tamArchivo, ruta, cabecera, error);
+
+}
+
+bool LectorFranjasBmp::leerFilas(int y, int filas, unsigned char* rgb, string& error){
+    /*
+ * @brief Lee las filas [y, y + filas) y las deja en rgb como RGB888 sin relleno, de arriba hacia abajo.
+ *
+ * Las filas de una franja están seguidas en el archivo (al revés si el archivo va de abajo hacia arriba), así
+ * que se leen con una sola lectura y se convierten con copiarRgb.
+ */
+
+    if (archivo == nullptr || y < 0 || filas <= 0 || y + filas > cabecera.alto) {
+        error = nombre + ": filas fuera de la imagen";
+        return false;
+    }
+
+    // Primera fila de la franja en el orden del archivo
+    int primeraEnArchivo = cabecera.deArribaHaciaAbajo ? y : cabecera.alto - (y + filas);
+    size_t bytes = cabecera.bytesFila * (size_t)filas;
+
+    if (lectura.size() < bytes) {
+        lectura = poolBuffers().obtener(bytes);
+    }
+
+    if (!posicionar(archivo, (uint64_t)cabecera.inicioPixeles + (uint64_t)cabecera.bytesFila * (uint64_t)primeraEnArchivo) ||
+        fread(lectura.data(), 1, bytes, archivo) != bytes) {
+        error = nombre + ": no se pudieron leer las filas";
+        return false;
+    }
+
+    VistaBmp vista;
+    vista.ancho = cabecera.ancho;
+    vista.alto = filas;
+    vista.bitsPorPixel = cabecera.bitsPorPixel;
+
+    if (cabecera.bitsPorPixel == 8) {
+        vista.paleta = cabeceras.data() + cabecera.inicioPaleta;
+        vista.coloresPaleta = cabecera.coloresPaleta;
+    }
+
+    if (cabecera.deArribaHaciaAbajo) {
+        vista.primeraFila = lectura.data();
+        vista.pasoFila = (ptrdiff_t)cabecera.bytesFila;
+    }
+    else {
+        vista.primeraFila = lectura.data() + cabecera.bytesFila * (size_t)(filas - 1);
+        vista.pasoFila = -(ptrdiff_t)cabecera.bytesFila;
+    }
+
+    copiarRgb(vista, rgb);
+
+    return true;
+
+}
+
+bool LectorFranjasBmp::leerBytes(size_t inicio, size_t fin, unsigned char* destino, string& error){
+    /*
+ * @brief Copia los bytes [inicio, fin) de la imagen RGB888 (sin relleno, de arriba hacia abajo) a destino.
+ *
+ * Se leen las filas que contienen el intervalo, de a FILAS_RANGO por vez.
+ */
+
+    const int FILAS_RANGO = 64;
+    size_t bytesFilaRgb = (size_t)cabecera.ancho * 3;
+
+    if (fin > bytesFilaRgb * (size_t)cabecera.alto || inicio > fin) {
+        error = nombre + ": bytes fuera de la imagen";
+        return false;
+    }
+
+    while (inicio < fin) {
+
+        int y = (int)(inicio / bytesFilaRgb);
+        int filas = (int)min<size_t>(FILAS_RANGO, (fin - 1) / bytesFilaRgb - y + 1);
+
+        if (filasRango.size() < bytesFilaRgb * (size_t)filas) {
+            filasRango = poolBuffers().obtener(bytesFilaRgb * FILAS_RANGO);
+        }
+
+        if (!leerFilas(y, filas, filasRango.data(), error)) {
+            return false;
+        }
+
+        size_t desde = inicio - bytesFilaRgb * (size_t)y;
+        size_t cantidad = min(fin - inicio, bytesFilaRgb * (size_t)filas - desde);
+
+        memcpy(destino, filasRango.data() + desde, cantidad);
+
+        destino += cantidad;
+        inicio += cantidad;
+
+    }
+
+    return true;
+
+}
+
+EscritorFranjasBmp::~EscritorFranjasBmp(){
+
+    if (archivo != nullptr) {
+        fclose(archivo);
+    }
+
+}
+
+bool EscritorFranjasBmp::abrir(const char* ruta, int ancho, int alto, string& error){
+    /*
+ * @brief Crea un BMP de 24 bits y escribe sus cabeceras; las filas se escriben después con escribirFilas.
+ */
+
+    if (archivo != nullptr) {
+        fclose(archivo);
+    }
+
+    nombre = ruta;
+    this->ancho = ancho;
+    this->alto = alto;
+    bytesFila = ((size_t)ancho * 3 + 3) / 4 * 4;
+    archivo = fopen(ruta, "wb");
+
+    if (archivo == nullptr) {
+        error = string("No se pudo crear la imagen ") + ruta;
+        return false;
+    }
+
+    unsigned char cabecera[54];
+    escribirCabeceraBmp(cabecera, ancho, alto);
+
+    if (fwrite(cabecera, 1, sizeof(cabecera), archivo) != sizeof(cabecera)) {
+        error = string("No se pudo escribir la imagen ") + ruta;
+        return false;
+    }
+
+    return true;
+
+}
+
+bool EscritorFranjasBmp::escribirFilas(int y, int filas, const unsigned char* rgb, string& error){
+    /*
+ * @brief Escribe las filas [y, y + filas) a partir de un arreglo RGB888 sin relleno, de arriba hacia abajo.
+ *
+ * El archivo va de abajo hacia arriba, así que la franja se convierte a BGR en orden inverso y se escribe con
+ * una sola escritura en su posición.
+ */
+
+    if (archivo == nullptr || y < 0 || filas <= 0 || y + filas > alto) {
+        error = nombre + ": filas fuera de la imagen";
+        return false;
+    }
+
+    size_t bytes = bytesFila * (size_t)filas;
+
+    if (escritura.size() < bytes) {
+        escritura = poolBuffers().obtener(bytes);
+    }
+
+    for (int f = 0; f < filas; f++) {
+
+        const unsigned char* origen = rgb + (size_t)ancho * 3 * f;
+        unsigned char* destino = escritura.data() + bytesFila * (size_t)(filas - 1 - f);
+
+        for (int x = 0; x < ancho; x++) {
+            destino[3 * x]     = origen[3 * x + 2];
+            destino[3 * x + 1] = origen[3 * x + 1];
+            destino[3 * x + 2] = origen[3 * x];
+        }
+
+        memset(destino + (size_t)ancho * 3, 0, bytesFila - (size_t)ancho * 3);
+
+    }
+
+    uint64_t posicion = 54 + (uint64_t)bytesFila * (uint64_t)(alto - (y + filas));
+
+    if (!posicionar(archivo, posicion) || fwrite(escritura.data(), 1, bytes, archivo) != bytes) {
+        error = string("No se pudo escribir la imagen ") + nombre;
+        return false;
+    }
+
+    return true;
+
+}
+
+bool EscritorFranjasBmp::cerrar(string& error){
+
+    if (archivo == nullptr) {
+        return true;
+    }
+
+    bool cerrado = (fclose(archivo) == 0);
+    archivo = nullptr;
+
+    if (!cerrado) {
+        error = string("No se pudo escribir la imagen ") + nombre;
+    }
+
+    return cerrado;
+
+}
@@ -0,0 +1,206 @@
+#ifndef IMAGENES_H
+#define IMAGENES_H
+
+/* Lectura y escritura de imágenes BMP sin Qt
+ *
+ * El archivo se proyecta en memoria y los píxeles se leen directamente de la proyección. Se soportan los BMP sin
+ * compresión de 24 bits (el formato de I_D, I_M y M), 32 bits y 8 bits con paleta, con las filas guardadas de
+ * abajo hacia arriba (lo habitual) o de arriba hacia abajo. Las imágenes se escriben siempre como BMP de 24 bits,
+ * en el hilo que llama (escribirBmp) o en un hilo de fondo (EscritorImagenes).
+ *
+ * Para las imágenes que no caben en memoria (--stream), LectorFranjasBmp y EscritorFranjasBmp leen y escriben de
+ * a varias filas con lecturas y escrituras normales, sin proyectar el archivo.
+ */
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "archivos.h"
+#include "memoria.h"
+
+// Vista de los píxeles de un BMP proyectado en memoria, sin copiarlos
+struct VistaBmp {
+    const unsigned char* primeraFila = nullptr;     // Fila superior de la imagen
+    ptrdiff_t pasoFila = 0;                         // Bytes entre filas (con relleno); negativo si el archivo va de abajo hacia arriba
+    int ancho = 0;
+    int alto = 0;
+    int bitsPorPixel = 0;                           // 24 y 32: B, G, R(, X); 8: índices en la paleta
+    const unsigned char* paleta = nullptr;          // Entradas B, G, R, 0 (solo 8 bits)
+    int coloresPaleta = 0;
+
+    const unsigned char* fila(int y) const { return primeraFila + y * pasoFila; }
+};
+
+// Cabeceras de un BMP como posiciones dentro del archivo, sin punteros a sus datos
+struct CabeceraBmp {
+    size_t inicioPixeles = 0;
+    size_t bytesFila = 0;                           // Con relleno
+    int ancho = 0;
+    int alto = 0;
+    int bitsPorPixel = 0;
+    bool deArribaHaciaAbajo = false;
+    size_t inicioPaleta = 0;                        // Solo 8 bits
+    int coloresPaleta = 0;
+};
+
+bool leerCabeceraBmp(const unsigned char* p, size_t disponibles, size_t tamArchivo, const char* ruta, CabeceraBmp& cabecera, std::string& error);
+bool leerVistaBmp(const unsigned char* p, size_t tam, const char* ruta, VistaBmp& vista, std::string& error);
+
+// Archivo BMP abierto; la vista es válida mientras el objeto exista
+class ImagenBmp {
+public:
+    bool abrir(const char* ruta, std::string& error);
+
+    const VistaBmp& vista() const { return datos; }
+
+private:
+    ArchivoMapeado archivo;
+    VistaBmp datos;
+};
+
+// Imagen RGB888 sin relleno, de la fila superior a la inferior (buffer alineado de poolBuffers())
+struct ImagenRgb {
+    int ancho = 0;
+    int alto = 0;
+    BufferAlineado pixeles;
+};
+
+// BMP de 24 bits listo para escribir: cabeceras y filas BGR con su relleno, de abajo hacia arriba
+struct ImagenCodificada {
+    unsigned char cabecera[54];
+    BufferAlineado pixeles;             // Vuelve a poolBuffers() cuando la imagen se termina de escribir
+};
+
+void copiarRgb(const VistaBmp& vista, unsigned char* destino);
+bool cargarRgb(const char* ruta, ImagenRgb& imagen, std::string& error);
+bool cargarRgb(const unsigned char* datos, size_t tam, const char* nombre, ImagenRgb& imagen, std::string& error);
+void codificarBmp(const unsigned char* rgb, int ancho, int alto, ImagenCodificada& imagen);
+bool escribirCodificada(const char* ruta, const ImagenCodificada& imagen, std::string& error);
+bool escribirBmp(const char* ruta, const unsigned char* rgb, int ancho, int alto, std::string& error);
+
+// Bytes de píxeles codificados que un EscritorImagenes tiene a la vez (codificándose, en la cola o escribiéndose)
+const size_t LIMITE_BYTES_ESCRITOR = (size_t)256 << 20;
+
+// Hilo que escribe las imágenes en disco mientras el hilo principal sigue con la siguiente etapa
+class EscritorImagenes {
+public:
+    explicit EscritorImagenes(size_t limiteBytes = LIMITE_BYTES_ESCRITOR);
+    ~EscritorImagenes();                    // Escribe lo que quede en la cola antes de terminar
+
+    EscritorImagenes(const EscritorImagenes&) = delete;
+    EscritorImagenes& operator=(const EscritorImagenes&) = delete;
+
+    bool encolar(const std::string& ruta, const unsigned char* rgb, int ancho, int alto);
+    bool esperar(std::vector<std::string>& errores);      // Espera a que la cola se vacíe; false si alguna escritura falló
+
+private:
+    struct Trabajo {
+        std::string ruta;
+        ImagenCodificada imagen;
+        size_t bytes = 0;                   // Reservados en bytesPendientes
+    };
+
+    void trabajar();
+
+    size_t limiteBytes;                     // Una imagen más grande que el límite pasa sola, cuando no hay otra pendiente
+    size_t bytesPendientes = 0;             // Reservados por imágenes que se codifican, esperan o se escriben
+    std::deque<Trabajo> cola;
+    std::vector<std::string> errores;
+    bool terminar = false;
+
+    std::mutex candado;
+    std::condition_variable hayTrabajo;
+    std::condition_variable hayLugar;
+    std::condition_variable vacia;
+    std::thread hilo;
+};
+
+// Imágenes de solo lectura (I_M, M) compartidas entre casos: un mismo archivo (sin modificar) o un mismo contenido
+// recibido en memoria se decodifica una sola vez
+class CacheImagenes {
+public:
+    explicit CacheImagenes(size_t capacidad = 0);      // 0: sin límite
+
+    std::shared_ptr<const ImagenRgb> obtener(const std::string& ruta, std::string& error);
+    std::shared_ptr<const ImagenRgb> obtener(const unsigned char* datos, size_t tam, const char* nombre, std::string& error);
+
+    size_t cargadas() const;                // Imágenes distintas en la caché
+    size_t reutilizadas() const;            // Pedidos resueltos sin volver a decodificar
+    size_t descartadas() const;             // Imágenes sacadas por falta de lugar
+
+private:
+    struct Entrada {
+        std::shared_ptr<const ImagenRgb> imagen;
+        std::shared_ptr<const std::vector<unsigned char>> contenido;     // BMP recibido, para confirmar los aciertos; nullptr para un archivo
+        std::list<std::string>::iterator uso;
+    };
+
+    std::shared_ptr<const ImagenRgb> buscar(const std::string& clave, const unsigned char* datos, size_t tam, bool& colision);
+    std::shared_ptr<const ImagenRgb> guardar(const std::string& clave, std::shared_ptr<const ImagenRgb> imagen, std::shared_ptr<const std::vector<unsigned char>> contenido);
+
+    size_t capacidad;
+    mutable std::mutex candado;
+    std::unordered_map<std::string, Entrada> imagenes;  // Por archivo (ruta, inodo, tamaño y fecha) o por hash del contenido recibido
+    std::list<std::string> usos;                        // De la usada más recientemente a la más antigua
+    size_t aciertos = 0;
+    size_t desalojos = 0;
+};
+
+// BMP que se lee de a varias filas (--stream): en memoria solo quedan las cabeceras y la última franja leída
+class LectorFranjasBmp {
+public:
+    LectorFranjasBmp() = default;
+    ~LectorFranjasBmp();
+
+    LectorFranjasBmp(const LectorFranjasBmp&) = delete;
+    LectorFranjasBmp& operator=(const LectorFranjasBmp&) = delete;
+
+    bool abrir(const char* ruta, std::string& error);
+    bool leerFilas(int y, int filas, unsigned char* rgb, std::string& error);
+    bool leerBytes(size_t inicio, size_t fin, unsigned char* destino, std::string& error);
+
+    int ancho() const { return cabecera.ancho; }
+    int alto() const { return cabecera.alto; }
+
+private:
+    FILE* archivo = nullptr;
+    std::string nombre;
+    CabeceraBmp cabecera;
+    std::vector<unsigned char> cabeceras;           // Bytes del archivo hasta el inicio de los píxeles (incluye la paleta)
+    BufferAlineado lectura;                         // Filas tal como están en el archivo
+    BufferAlineado filasRango;                      // Filas convertidas para leerBytes
+};
+
+// BMP de 24 bits que se escribe de a varias filas, en cualquier orden
+class EscritorFranjasBmp {
+public:
+    EscritorFranjasBmp() = default;
+    ~EscritorFranjasBmp();
+
+    EscritorFranjasBmp(const EscritorFranjasBmp&) = delete;
+    EscritorFranjasBmp& operator=(const EscritorFranjasBmp&) = delete;
+
+    bool abrir(const char* ruta, int ancho, int alto, std::string& error);
+    bool escribirFilas(int y, int filas, const unsigned char* rgb, std::string& error);
+    bool cerrar(std::string& error);
+
+private:
+    FILE* archivo = nullptr;
+    std::string nombre;
+    int ancho = 0;
+    int alto = 0;
+    size_t bytesFila = 0;
+    BufferAlineado escritura;
+};
+
+#endif // IMAGENES_H
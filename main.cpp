@@ -21,830 +21,1325 @@
  *
 */
 
-#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <future>
 #include <iostream>
-#include <QCoreApplication>
+#include <mutex>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// La compilación sin Qt (ProjectParamsHeadless.pro) define SIN_QT y usa solo el lector de BMP propio
+#ifndef SIN_QT
 #include <QImage>
+#endif
+
+#include "operaciones.h"
+#include "paralelo.h"
+#include "busqueda.h"
+#include "archivos.h"
+#include "imagenes.h"
+#include "memoria.h"
+#include "metricas.h"
+#include "reconstruccion.h"
+#include "servidor.h"
 
 using namespace std;
 
 /* ******************************* Declaración de funnciones ******************************* */
 
 
-unsigned char* loadPixels(QString input, int &width, int &height);
-bool exportImage(unsigned char* pixelData, int width,int height, QString archivoSalida);
-unsigned int* loadSeedMasking(const char* nombreArchivo, int &seed, int &n_pixels);
-
-unsigned char desplazamientoIzq(unsigned char Id, int n);
-unsigned char desplazamientoDer(unsigned char Id, int n);
-unsigned char rotacionIzq(unsigned char Id, int n);
-unsigned char rotacionDer(unsigned char Id, int n);
-unsigned char operacionXor(unsigned char Id, unsigned char IM);
-unsigned char* revertirEnmas(unsigned int* Id, unsigned char* M, int i, int j);
-void enmascaramiento(unsigned char* Id, int wId, int hId, unsigned char* M, int wM, int hM, int s);
+BufferAlineado loadPixels(const string& input, int &width, int &height);
+bool exportImage(unsigned char* pixelData, int width,int height, const string& archivoSalida, EscritorImagenes* escritor = nullptr);
+
+bool convertirEnmascaramiento(const char* entrada, const char* salida, const string& mascara, bool preimagenes);
+
+// Opciones de la línea de comandos que afectan la reconstrucción de cada caso
+struct OpcionesReconstruccion {
+    bool volcarValidacion = false;          // --dump-validation: escribe Validacion.txt con las sumas de la etapa
+    bool volcarEtapas = false;              // --dump-stages: exporta la imagen de cada etapa
+    bool busquedaParalela = false;          // --parallel-search: reparte la ventana de cada etapa entre los hilos
+    bool precargar = false;                 // --pipeline: carga los enmascaramientos de las etapas en paralelo
+    bool porFranjas = false;                // --stream: lee y escribe las imágenes de a franjas, sin cargarlas completas
+    int filasFranja = 256;                  // --strip-rows: filas de cada franja con --stream
+    bool perezosa = false;                  // --lazy: identifica sobre las ventanas y recorre la imagen una sola vez al final
+    ConfiguracionBusqueda configBusqueda;   // Límites de la búsqueda con retroceso
+};
+
+// Archivos de un caso: imagen de entrada, un archivo de enmascaramiento por etapa y las salidas
+struct CasoReconstruccion {
+    std::string entrada;                            // Imagen después de la última etapa
+    std::string rutaImask;                          // I_M.bmp y M.bmp del directorio (--batch)
+    std::string rutaMascara;
+    std::vector<std::string> enmascaramientos;      // M0.txt ... M{n-1}.txt (se usa el .bin si existe)
+    std::vector<std::string> salidasEtapas;         // Imagen de cada etapa para --dump-stages
+    std::string validacion;                         // Archivo de --dump-validation
+    std::string final;                              // Imagen reconstruida
+    std::vector<std::string> contenidos;            // Contenido de cada M{k} ya recibido en memoria (--daemon); vacío: se leen los archivos
+
+    const std::string* contenido(int etapa) const { return contenidos.empty() ? nullptr : &contenidos[etapa]; }
+};
+
+// Archivos de --metrics-json y --metrics-prom (vacíos: sin informe)
+struct RutasMetricas {
+    std::string json;
+    std::string prometheus;
+
+    bool activas() const { return !json.empty() || !prometheus.empty(); }
+};
+
+bool reconstruirCaso(const CasoReconstruccion& caso, unsigned char* validacData, int width, int height, const unsigned char* ImaskData, int wIm, int hIm, const unsigned char* maskData, int wm, int hm, PoolHilos& pool, EscritorImagenes& escritor, const OpcionesReconstruccion& opciones, ostream& salida, MetricasCaso* metricas = nullptr);
+bool reconstruirCasoPorFranjas(const CasoReconstruccion& caso, const string& rutaImask, const string& rutaMascara, PoolHilos& pool, const OpcionesReconstruccion& opciones, ostream& salida, MetricasCaso* metricas = nullptr);
+bool cargarEtapas(const CasoReconstruccion& caso, const unsigned char* maskData, size_t tamVentana, const OpcionesReconstruccion& opciones, vector<RanuraEnmascaramiento>& ranuras, vector<EtapaEnmascaramiento>& etapas, ostream& salida, MetricasCaso* metricas);
+void informarEtapa(const EtapaReconstruida& etapa, ostream& salida);
+void informarRetroceso(int etapaFallida, int desde, ostream& salida);
+void medirEtapa(const EtapaReconstruida& etapa, MetricasEtapa& medida, unsigned long long& reservasEtapa);
+bool informarResultado(const ResultadoReconstruccion& resultado, const OpcionesReconstruccion& opciones, ostream& salida);
+void escribirMetricasCaso(MetricasCaso& metricas, bool reconstruido, const Cronometro& cronometro, unsigned long long reservasInicio, const RutasMetricas& rutasMetricas);
+bool descubrirCaso(const string& directorio, CasoReconstruccion& caso, string& error);
+bool reconstruirDirectorio(const string& directorio, CasoReconstruccion& caso, CacheImagenes& cache, PoolHilos& pool, EscritorImagenes& escritor, const OpcionesReconstruccion& opciones, ostream& informe, MetricasCaso* metricas = nullptr);
+int reconstruirLote(const vector<string>& directorios, int cantidadHilos, const OpcionesReconstruccion& opciones, const RutasMetricas& rutasMetricas);
+int servirReconstrucciones(const string& rutaSocket, int cantidadHilos, size_t capacidadCache, const OpcionesReconstruccion& opciones, const RutasMetricas& rutasMetricas);
+size_t bytesBmp(int width, int height);
 
 
 /* ********************************************* Función Principal ************************************************ */
 
-int main()
+int main(int argc, char* argv[])
 {
     int n=0;
 
-    cout<<endl<<"Bienvenido, carga la imagen distorsionda I_D.bmp, junto con la imagen para las operaciones XOR I_M.bmp y la imagen mascara M.bmp."<<endl;
-    cout<<endl<<"Carga los archivos con el resultado del enmascaramiento, de acuerdo con ello, ingresa el numero de etapas del proceso: ";
-    cin>>n;
+    // Opciones de cada reconstrucción (--dump-validation, --dump-stages, --parallel-search, --pipeline y límites de búsqueda)
+    OpcionesReconstruccion opciones;
 
-    // Definición de rutas de archivo de entrada (imagen original), salida (imagen modificada), de la imagen máscara y de la máscara
-    QString archivosEntradaBMP [7]={"Etapa1.bmp","Etapa2.bmp","Etapa3.bmp","Etapa4.bmp","Etapa5.bmp","Etapa6.bmp","I_D.bmp"};
-    QString archivosSalidaBMP [7]={"Etapa1.bmp","Etapa2.bmp","Etapa3.bmp","Etapa4.bmp","Etapa5.bmp","Etapa6.bmp","Etapa7.bmp"};
-    const char* archivosTXT [7]={"M0.txt","M1.txt","M2.txt","M3.txt","M4.txt","M5.txt","M6.txt"};
-    QString Imascara = "I_M.bmp";
-    QString mascara = "M.bmp";
+    // Hilos para las operaciones sobre la imagen completa, o para los casos con --batch (0 = los que reporte el sistema)
+    int cantidadHilos=0;
 
-    // Variables para almacenar las dimensiones de la imagen máscara y de la máscara
-    int hIm=0;
-    int wIm=0;
+    // --batch dir1 dir2 ... reconstruye cada directorio sin preguntar el número de etapas
+    vector<string> directoriosLote;
 
-    int hm=0;
-    int wm=0;
+    // --daemon ruta.sock deja el proceso atendiendo pedidos; --cache-size N limita las imágenes I_M/M en memoria
+    const char* rutaSocket=nullptr;
+    size_t capacidadCache=16;
 
-    // Carga la imagen máscara BMP en memoria dinámica y obtiene ancho y alto
-    unsigned char *ImaskData = loadPixels(Imascara, wIm, hIm);
+    // --convert-masking entrada.txt salida.bin [--preimages] convierte un archivo de enmascaramiento al formato binario
+    const char* convertirEntrada=nullptr;
+    const char* convertirSalida=nullptr;
+    bool convertirPreimagenes=false;
 
-    // Carga la máscara BMP en memoria dinámica y obtiene ancho y alto
-    unsigned char *maskData = loadPixels(mascara, wm, hm);
+    // --metrics-json archivo y --metrics-prom archivo escriben el tiempo de cada fase y etapa, los bytes y la memoria
+    RutasMetricas rutasMetricas;
 
-    cout<<endl;
-    cout<<"Las tranformaciones realizadas fueron las siguiente: "<<endl;
+    for (int a=1;a<argc;a++){
+
+        string opcion = argv[a];
 
-    for (int etapa=n-1;etapa>=0;etapa--){
+        if (opcion=="--dump-validation"){
+            opciones.volcarValidacion=true;
+        }
+
+        else if (opcion=="--dump-stages"){
+            opciones.volcarEtapas=true;
+        }
+
+        // --threads N fija la cantidad de hilos de las operaciones sobre la imagen completa
+        else if (opcion=="--threads" && a+1<argc){
+            cantidadHilos = atoi(argv[++a]);
+        }
 
-        // Variables para almacenar las dimensiones de la imagen
-        int height = 0;
-        int width = 0;
+        else if (opcion=="--parallel-search"){
+            opciones.busquedaParalela=true;
+        }
 
-        // Carga la imagen BMP en memoria dinámica y obtiene ancho y alto
-        unsigned char *pixelData = loadPixels(archivosEntradaBMP[etapa], width, height);
+        else if (opcion=="--pipeline"){
+            opciones.precargar=true;
+        }
 
-        /* Asegurarse que las dimensiones coincidan
-        if (width != wIm || height != hIm) {
-            cout << "Las imagenes no tienen el mismo tamaño." << endl;
-            return -1; //convención para indicar que hay un error
-        }*/
+        // --stream reconstruye de a franjas de --strip-rows N filas las imágenes que no caben en memoria
+        else if (opcion=="--stream"){
+            opciones.porFranjas=true;
+        }
 
-        if (etapa!=n-1){
+        else if (opcion=="--strip-rows" && a+1<argc){
+            opciones.filasFranja = max(1, atoi(argv[++a]));
+        }
 
-            // Variables para almacenar la semilla y el número de píxeles leídos del archivo de enmascaramiento
-            int seed = 0;
-            int n_pixels = 0;
+        // --lazy aplica las operaciones de todas las etapas a la imagen en una sola pasada, al final
+        else if (opcion=="--lazy"){
+            opciones.perezosa=true;
+        }
 
-            // Carga los datos de enmascaramiento desde un archivo .txt (semilla + valores RGB)
-            unsigned int *maskingData = loadSeedMasking(archivosTXT[etapa+1], seed, n_pixels);
+        // --max-ops N, --max-nodes N y --time-budget-ms N limitan la búsqueda de secuencias por etapa
+        else if (opcion=="--max-ops" && a+1<argc){
+            opciones.configBusqueda.maxOperaciones = atoi(argv[++a]);
+        }
 
-            // Revertir enmascaramiento
-            unsigned char *original=revertirEnmas(maskingData,maskData,hm,wm);
+        else if (opcion=="--max-nodes" && a+1<argc){
+            opciones.configBusqueda.maxNodos = atoll(argv[++a]);
+        }
 
-            for (int i=0; i <hm*wm*3; i++) {
+        else if (opcion=="--time-budget-ms" && a+1<argc){
+            opciones.configBusqueda.maxMilisegundos = atoll(argv[++a]);
+        }
 
-                if(i+seed>height*width){
-                    //cout<<endl<<"La semilla es muy grande posible desbordamiento"<<endl;
-                    break;
-                }
-                else{
-                    pixelData[i+seed] = original[i];
-                }
+        // --simd escalar|sse2|avx2|avx512 fuerza el juego de instrucciones de las operaciones sobre buffers
+        else if (opcion=="--simd" && a+1<argc){
 
-            }
+            NivelSimd nivel;
 
-            if (maskingData != nullptr){
-                delete[] maskingData;
-                maskingData = nullptr;
+            if (!leerNivelSimd(argv[++a], nivel) || !seleccionarNivelSimd(nivel)){
+                cout<<"Nivel SIMD no disponible, se usa: "<<nombreNivelSimd(nivelSimdActivo())<<endl;
             }
 
-            delete [] original;
+        }
 
+        // --huge-pages reserva las imágenes de poolBuffers() en páginas de 2 MiB cuando el sistema lo permite
+        else if (opcion=="--huge-pages"){
+            poolBuffers().usarPaginasGrandes(true);
         }
 
-        // Exporta la imagen modificada a un nuevo archivo BMP
-        exportImage(pixelData, width, height, archivosSalidaBMP[etapa]);        
+        else if (opcion=="--convert-masking" && a+2<argc){
+            convertirEntrada = argv[++a];
+            convertirSalida = argv[++a];
+        }
 
-        // Variables para almacenar las dimensiones de la imagen sin la máscara
-        int hvalidacion = 0;
-        int wvalidacion = 0;
+        else if (opcion=="--preimages"){
+            convertirPreimagenes=true;
+        }
 
-        // Carga la imagen sin máscara BMP en memoria dinámica y obtiene ancho y alto
-        unsigned char *validacData = loadPixels(archivosSalidaBMP[etapa], wvalidacion, hvalidacion);
+        else if (opcion=="--daemon" && a+1<argc){
+            rutaSocket = argv[++a];
+        }
 
-        int totalSize = width*height*3;
+        else if (opcion=="--cache-size" && a+1<argc){
+            capacidadCache = (size_t)atoll(argv[++a]);
+        }
 
-        // Variables para almacenar la semilla y el número de píxeles leídos del archivo de enmascaramiento
-        int seed1 = 0;
-        int n_pixels1 = 0;
+        else if (opcion=="--metrics-json" && a+1<argc){
+            rutasMetricas.json = argv[++a];
+        }
 
-        // Carga los datos de enmascaramiento desde un archivo .txt (semilla + valores RGB)
-        unsigned int *maskingData1 = loadSeedMasking(archivosTXT[etapa], seed1, n_pixels1);
+        else if (opcion=="--metrics-prom" && a+1<argc){
+            rutasMetricas.prometheus = argv[++a];
+        }
 
-        bool validacion=true;
+        // Los directorios del lote son los argumentos que siguen a --batch hasta la siguiente opción
+        else if (opcion=="--batch"){
+            while (a+1<argc && string(argv[a+1]).rfind("--", 0) != 0){
+                directoriosLote.push_back(argv[++a]);
+            }
+        }
 
-        do{
+    }
 
-            /* *************************************** Operación XOR *************************************** */
+    if (rutaSocket != nullptr){
+        return servirReconstrucciones(rutaSocket, cantidadHilos, capacidadCache, opciones, rutasMetricas);
+    }
 
+    if (!directoriosLote.empty()){
+        return reconstruirLote(directoriosLote, cantidadHilos, opciones, rutasMetricas);
+    }
 
-            for (int i = 0; i < totalSize; i++) {
+    if (convertirEntrada != nullptr){
+        return convertirEnmascaramiento(convertirEntrada, convertirSalida, "M.bmp", convertirPreimagenes) ? 0 : 1;
+    }
 
-                //XOR con la imagen máscara
-                validacData[i] = operacionXor(validacData[i], ImaskData[i]);
+    cout<<endl<<"Bienvenido, carga la imagen distorsionda I_D.bmp, junto con la imagen para las operaciones XOR I_M.bmp y la imagen mascara M.bmp."<<endl;
+    cout<<endl<<"Carga los archivos con el resultado del enmascaramiento, de acuerdo con ello, ingresa el numero de etapas del proceso: ";
+    cin>>n;
 
-            }
+    // Los nombres de archivo de las etapas están definidos para 1 a 7 etapas
+    if (n < 1 || n > 7){
+        cout<<endl<<"El numero de etapas debe estar entre 1 y 7."<<endl;
+        return 1;
+    }
 
-            enmascaramiento(validacData, wvalidacion, hvalidacion, maskData, wm,hm,seed1);
+    // Definición de rutas de archivo de entrada (imagen original), salida (imagen modificada), de la imagen máscara y de la máscara
+    string archivosEntradaBMP [7]={"Etapa1.bmp","Etapa2.bmp","Etapa3.bmp","Etapa4.bmp","Etapa5.bmp","Etapa6.bmp","I_D.bmp"};
+    string archivosSalidaBMP [7]={"Etapa1.bmp","Etapa2.bmp","Etapa3.bmp","Etapa4.bmp","Etapa5.bmp","Etapa6.bmp","Etapa7.bmp"};
+    const char* archivosTXT [7]={"M0.txt","M1.txt","M2.txt","M3.txt","M4.txt","M5.txt","M6.txt"};
+    string Imascara = "I_M.bmp";
+    string mascara = "M.bmp";
+
+    // Archivos del caso en el directorio de trabajo
+    CasoReconstruccion caso;
+    caso.entrada = archivosEntradaBMP[n-1];
+    caso.validacion = "Validacion.txt";
+    caso.final = "Final.bmp";
+
+    for (int etapa=0;etapa<n;etapa++){
+        caso.enmascaramientos.push_back(archivosTXT[etapa]);
+        caso.salidasEtapas.push_back(archivosSalidaBMP[etapa]);
+    }
 
-            int n_pixels2=0;
+    // Variables para almacenar las dimensiones de la imagen máscara y de la máscara
+    int hIm=0;
+    int wIm=0;
 
-            unsigned int *validacionData = loadSeedMasking("Validacion.txt", seed1, n_pixels2);
+    int hm=0;
+    int wm=0;
 
-            if (n_pixels2!=n_pixels1){
+    // Mediciones del caso (solo se escriben con --metrics-json o --metrics-prom)
+    MetricasCaso metricas;
+    metricas.nombre = ".";
+    unsigned long long reservasInicio = reservasMemoria();
+    Cronometro cronometroCaso;
 
-                // Limpiar memoria dinámica
-                if (validacionData != nullptr){
-                    delete[] validacionData;
-                    validacionData = nullptr;
-                }
+    // Con --stream las imágenes no se cargan completas: se leen y se escriben de a franjas
+    if (opciones.porFranjas){
 
-                break;
-            }
+        PoolHilos pool(cantidadHilos);
 
-            else{
+        cout<<endl;
+        cout<<"Las tranformaciones realizadas fueron las siguiente: "<<endl;
 
-                for (int k = 0; k < n_pixels2*3; k++) {
+        bool reconstruido = reconstruirCasoPorFranjas(caso, Imascara, mascara, pool, opciones, cout, &metricas);
 
-                    if (validacionData[k]!=maskingData1[k]){
-                        validacion=false;
-                        break;
-                    }
+        escribirMetricasCaso(metricas, reconstruido, cronometroCaso, reservasInicio, rutasMetricas);
+        cout<<endl;
 
-                    else{
-                        validacion=true;
+        return reconstruido ? 0 : 1;
 
-                    }
+    }
 
-                }
+    // Carga la imagen máscara BMP en memoria dinámica y obtiene ancho y alto (con --pipeline, en otro hilo
+    // mientras se cargan la máscara y la imagen de entrada)
+    future<BufferAlineado> cargaImask = async(opciones.precargar ? launch::async : launch::deferred, [&]{ return loadPixels(Imascara, wIm, hIm); });
 
-                // Limpiar memoria dinámica
-                if (validacionData != nullptr){
-                    delete[] validacionData;
-                    validacionData = nullptr;
-                }
+    // Carga la máscara BMP en memoria dinámica y obtiene ancho y alto
+    BufferAlineado bufferMascara = loadPixels(mascara, wm, hm);
 
-            }
+    PoolHilos pool(cantidadHilos);
 
-            if (validacion==true){
+    cout<<endl;
+    cout<<"Las tranformaciones realizadas fueron las siguiente: "<<endl;
 
-                cout<<endl<<"Operacion XOR con la imagen I_M en la etapa: "<<etapa+1<<endl;
-                break;
+    // Variables para almacenar las dimensiones de la imagen
+    int height = 0;
+    int width = 0;
 
-            }
+    // Solo se carga la imagen de entrada: la imagen de cada etapa pasa a la siguiente en memoria
+    BufferAlineado bufferEntrada = loadPixels(caso.entrada, width, height);
+    BufferAlineado bufferImask = cargaImask.get();
 
-            else{
+    unsigned char *validacData = bufferEntrada.data();
+    unsigned char *ImaskData = bufferImask.data();
+    unsigned char *maskData = bufferMascara.data();
 
-                //cout<<endl<<"No es operacion XOR en etapa: "<<etapa+1<<endl;
+    metricas.segundos[FASE_CARGA_IMAGENES] = cronometroCaso.segundos();
+    metricas.bytesLeidos = tamanoArchivo(Imascara) + tamanoArchivo(mascara) + tamanoArchivo(caso.entrada);
 
-                for (int i = 0; i < totalSize; i++) {
+    if (validacData == nullptr || ImaskData == nullptr || maskData == nullptr){
+        return 1;
+    }
 
-                    //XOR con la imagen máscara para revertir la operación que no es
-                    validacData[i] = operacionXor(validacData[i], ImaskData[i]);
+    // Las imágenes exportadas (Etapa*.bmp y Final.bmp) se escriben en un hilo aparte mientras sigue la reconstrucción
+    EscritorImagenes escritor;
 
-                }
+    bool reconstruido = reconstruirCaso(caso, validacData, width, height, ImaskData, wIm, hIm, maskData, wm, hm, pool, escritor, opciones, cout, &metricas);
 
-            }            
+    // Espera a que terminen de escribirse las imágenes exportadas
+    vector<string> erroresEscritura;
 
+    if (!escritor.esperar(erroresEscritura)){
+        for (const string& error : erroresEscritura) {
+            cout<<"Error: No se pudo guardar la imagen BMP modificada ("<<error<<")."<<endl;
+        }
+    }
 
-            /* ********************************************** Rotación a la derecha ********************************************* */
+    escribirMetricasCaso(metricas, reconstruido, cronometroCaso, reservasInicio, rutasMetricas);
 
+    cout<<endl;
 
-            for (int j=1;j<9;j++){
+    // Los buffers de las imágenes vuelven a poolBuffers() al salir de main
 
-                for (int i = 0; i < totalSize; i++) {
+    return reconstruido ? 0 : 1; // Fin del programa
+}
 
-                    // Original rotar a la derecha
-                    validacData[i] = rotacionIzq(validacData[i], j);
 
-                }
+/* ********************************************* Reconstrucción de un caso ************************************************ */
 
-                enmascaramiento(validacData, wvalidacion, hvalidacion, maskData, wm,hm,seed1);
+bool reconstruirCaso(const CasoReconstruccion& caso, unsigned char* validacData, int width, int height, const unsigned char* ImaskData, int wIm, int hIm, const unsigned char* maskData, int wm, int hm, PoolHilos& pool, EscritorImagenes& escritor, const OpcionesReconstruccion& opciones, ostream& salida, MetricasCaso* metricas){
+    /*
+ * @brief Lee los enmascaramientos de un caso, lo reconstruye con la biblioteca y escribe el informe y las imágenes.
+ *
+ * La reconstrucción en sí (reconstruir, en reconstruccion.cpp) trabaja solo sobre buffers; aquí se abren los
+ * archivos de enmascaramiento, se informan las operaciones encontradas y se exportan las imágenes pedidas.
+ * Todos los mensajes van a 'salida', de modo que varios casos pueden reconstruirse a la vez sin mezclar sus
+ * informes.
+ *
+ * @param caso Archivos del caso (entrada, un enmascaramiento por etapa y salidas).
+ * @param validacData Imagen de entrada (RGB888 sin padding); se modifica en el lugar.
+ * @param width Ancho de la imagen.
+ * @param height Alto de la imagen.
+ * @param ImaskData Imagen I_M para las operaciones XOR (mismo tamaño que la imagen).
+ * @param wIm Ancho de I_M.
+ * @param hIm Alto de I_M.
+ * @param maskData Máscara M (RGB888 sin padding).
+ * @param wm Ancho de la máscara.
+ * @param hm Alto de la máscara.
+ * @param pool Hilos para las operaciones sobre la imagen completa.
+ * @param escritor Hilo que escribe las imágenes exportadas.
+ * @param opciones Opciones de la línea de comandos.
+ * @param salida Flujo donde se informan las operaciones encontradas y los errores.
+ * @param metricas Si se indica, recibe el tiempo, los bytes y las reservas de cada etapa y de la imagen final;
+ *                 la carga de las imágenes y los totales del caso quedan a cargo de quien llama.
+ *
+ * @return true si se reconstruyeron todas las etapas.
+ */
 
-                int n_pixels2=0;
+    // Tamaño de la ventana de enmascaramiento: solo estos bytes, a partir de la semilla, deciden la operación
+    size_t tamVentana = (size_t)wm*hm*3;
 
-                unsigned int *validacionData = loadSeedMasking("Validacion.txt", seed1, n_pixels2);
+    vector<RanuraEnmascaramiento> ranuras;
+    vector<EtapaEnmascaramiento> etapas;
 
-                if (n_pixels2!=n_pixels1){
+    if (!cargarEtapas(caso, maskData, tamVentana, opciones, ranuras, etapas, salida, metricas)){
+        return false;
+    }
 
-                    //cout<<endl<<"No es operacion rotacion a la derecha de "<<j<<"bits en la etapa: "<<etapa+1<<endl;
-                    validacion=false;
-                }
+    ConfiguracionReconstruccion config;
+    config.busquedaParalela = opciones.busquedaParalela;
+    config.busqueda = opciones.configBusqueda;
+    config.pool = &pool;
 
-                else{
+    // Con --lazy la imagen no pasa por cada etapa: no hay imágenes intermedias que exportar ni validar
+    bool volcarEtapas = opciones.volcarEtapas && !opciones.perezosa;
+    bool volcarValidacion = opciones.volcarValidacion && !opciones.perezosa;
+
+    if (opciones.perezosa && (opciones.volcarEtapas || opciones.volcarValidacion)){
+        salida<<endl<<"Advertencia: --dump-stages y --dump-validation no se usan con --lazy."<<endl;
+    }
 
-                    for (int k = 0; k < n_pixels2*3; k++) {
+    ObservadorReconstruccion observador;
+
+    // Con --dump-stages se exporta la imagen de la etapa a un archivo BMP para depuración
+    if (volcarEtapas){
+        observador.inicioEtapa = [&](int etapa, span<const uint8_t>){
+
+            Cronometro cronometro;
+            exportImage(validacData, width, height, caso.salidasEtapas[etapa], &escritor);
+
+            if (metricas != nullptr){
+                metricas->etapas[etapa].segundos[FASE_EXPORTACION] += cronometro.segundos();
+                metricas->etapas[etapa].bytesEscritos += bytesBmp(width, height);
+            }
 
-                        if (validacionData[k]!=maskingData1[k]){
-                            validacion=false;
-                            break;
-                        }
+        };
+    }
 
-                        else{
-                            validacion=true;
-                        }
+    // Las reservas de cada etapa se cuentan desde que terminó la anterior
+    unsigned long long reservasEtapa = reservasMemoria();
 
-                    }
+    observador.etapaRevertida = [&](const EtapaReconstruida& etapa, span<const uint8_t> imagen){
 
-                    // Limpiar memoria dinámica
-                    if (validacionData != nullptr){
-                        delete[] validacionData;
-                        validacionData = nullptr;
-                    }
+        informarEtapa(etapa, salida);
 
-                }
+        Cronometro cronometro;
 
-                if (validacion==true){
+        if (volcarValidacion){
+            enmascaramiento(imagen.data(), width, height, maskData, wm, hm, etapa.semilla, caso.validacion.c_str());
+        }
 
-                    cout<<endl<<"Rotacion a la derecha de "<<j<<" bits en la etapa: "<<etapa+1<<endl;
+        if (metricas != nullptr){
 
-                    break;
+            MetricasEtapa& medida = metricas->etapas[etapa.etapa];
 
-                }
+            if (volcarValidacion){
+                medida.segundos[FASE_EXPORTACION] += cronometro.segundos();
+                medida.bytesEscritos += tamanoArchivo(caso.validacion);
+            }
 
-                else{
+            medirEtapa(etapa, medida, reservasEtapa);
 
-                    //cout<<endl<<"No es operacion rotacion a la derecha de "<<j<<"bits en la etapa: "<<etapa+1<<endl;
+        }
 
-                    for (int i = 0; i < totalSize; i++) {
+    };
 
-                        // Revertir la rotación que no era correcta
-                        validacData[i] = rotacionDer(validacData[i], j);
+    observador.retroceso = [&](int etapaFallida, int desde){
 
-                    }
+        informarRetroceso(etapaFallida, desde, salida);
 
-                }               
+    };
 
-            }
+    VistaImagen imask = {span<const uint8_t>(ImaskData, (size_t)wIm*hIm*3), wIm, hIm};
+    VistaImagen mascara = {span<const uint8_t>(maskData, tamVentana), wm, hm};
 
-            if (validacion==true){
-                break;
-            }
+    span<uint8_t> imagen(validacData, (size_t)width*height*3);
+    ResultadoReconstruccion resultado = opciones.perezosa ? reconstruirPerezosa(imagen, width, height, imask, mascara, etapas, config, observador)
+                                                          : reconstruir(imagen, width, height, imask, mascara, etapas, config, observador);
 
+    if (metricas != nullptr){
+        metricas->segundos[FASE_APLICACION] += resultado.segundosAplicacionFinal;
+    }
 
-            /* ******************************************** Rotación a la iquierda ********************************************* */
+    if (!informarResultado(resultado, opciones, salida)){
+        return false;
+    }
 
+    // Exporta la imagen modificada a un nuevo archivo BMP
+    Cronometro cronometro;
+    exportImage(validacData, width, height, caso.final, &escritor);
 
-            for (int j=1;j<9;j++){
+    if (metricas != nullptr){
+        metricas->segundos[FASE_EXPORTACION] += cronometro.segundos();
+        metricas->bytesEscritos += bytesBmp(width, height);
+    }
 
-                for (int i = 0; i < totalSize; i++) {
+    salida<<endl;
 
-                    // Original rotar a la izquierda
-                    validacData[i] = rotacionDer(validacData[i], j);
+    return true;
 
-                }
+}
 
-                enmascaramiento(validacData, wvalidacion, hvalidacion, maskData, wm,hm,seed1);
+/* ********************************************* Partes comunes de la reconstrucción ************************************************ */
 
-                int n_pixels2=0;
+bool cargarEtapas(const CasoReconstruccion& caso, const unsigned char* maskData, size_t tamVentana, const OpcionesReconstruccion& opciones, vector<RanuraEnmascaramiento>& ranuras, vector<EtapaEnmascaramiento>& etapas, ostream& salida, MetricasCaso* metricas){
+    /*
+ * @brief Carga los enmascaramientos de un caso y arma la etapa de cada uno para la biblioteca.
+ *
+ * Los objetivos de las etapas apuntan a las ranuras, que deben vivir mientras se usen las etapas.
+ *
+ * @return false (con el error en 'salida') si algún archivo no se pudo abrir.
+ */
 
-                unsigned int *validacionData = loadSeedMasking("Validacion.txt", seed1, n_pixels2);
+    int n = (int)caso.enmascaramientos.size();
 
-                if (n_pixels2!=n_pixels1){
+    // Carga los datos de enmascaramiento: el .bin proyectado en memoria si existe, si no el .txt en un solo recorrido.
+    // Con --pipeline los archivos se reparten entre varios hilos de carga
+    ranuras = vector<RanuraEnmascaramiento>(n);
+    atomic<int> siguiente(0);
 
-                    //cout<<endl<<"No es operacion rotacion a la izquierda de "<<j<<"bits en la etapa: "<<etapa+1<<endl;
-                    validacion=false;
-                }
+    // Las etapas se crean antes de repartir la carga: cada hilo solo escribe las mediciones de las suyas
+    if (metricas != nullptr && n > 0){
+        metricas->etapa(n - 1);
+    }
 
-                else{
+    auto cargar = [&](){
+        for (int e; (e = siguiente++) < n; ) {
 
-                    for (int k = 0; k < n_pixels2*3; k++) {
+            Cronometro cronometro;
+            cargarRanura(ranuras[e], caso.enmascaramientos[e].c_str(), maskData, tamVentana, caso.contenido(e));
 
-                        if (validacionData[k]!=maskingData1[k]){
-                            validacion=false;
-                            break;
-                        }
+            if (metricas != nullptr){
+                metricas->etapas[e].segundos[FASE_CARGA_ENMASCARAMIENTO] = cronometro.segundos();
+                metricas->etapas[e].bytesLeidos = ranuras[e].fuente.bytes;
+            }
 
-                        else{
-                            validacion=true;
-                        }
+        }
+    };
 
-                    }
+    int hilosCarga = opciones.precargar ? min(n, max(1, (int)thread::hardware_concurrency())) : 1;
+    vector<future<void>> cargas;
 
-                    // Limpiar memoria dinámica
-                    if (validacionData != nullptr){
-                        delete[] validacionData;
-                        validacionData = nullptr;
-                    }
+    for (int h = 1; h < hilosCarga; h++) {
+        cargas.push_back(async(launch::async, cargar));
+    }
 
-                }
+    cargar();
 
-                if (validacion==true){
+    for (future<void>& carga : cargas) {
+        carga.get();
+    }
 
-                    cout<<endl<<"Rotacion a la izquierda de "<<j<<" bits en la etapa: "<<etapa+1<<endl;
+    etapas.assign(n, EtapaEnmascaramiento());
 
-                    break;
+    for (int etapa = 0; etapa < n; etapa++) {
 
-                }
+        const RanuraEnmascaramiento& ranura = ranuras[etapa];
 
-                else{
+        if (!ranura.abierto){
+            salida<<endl<<ranura.error<<endl;
+            return false;
+        }
 
-                    //cout<<endl<<"No es operacion rotacion a la izquierda de "<<j<<"bits en la etapa: "<<etapa+1<<endl;
+        // Las preimágenes de un .bin solo sirven con la máscara con la que se generaron
+        if (ranura.objetivos == nullptr && ranura.fuente.vista.preimagenes != nullptr){
+            salida<<endl<<"Advertencia: "<<ranura.ruta<<" no corresponde a la mascara M."<<endl;
+        }
 
-                    for (int i = 0; i < totalSize; i++) {
+        // Sin objetivos (alguna suma sin preimagen) la etapa queda vacía y la biblioteca la considera imposible
+        etapas[etapa].semilla = ranura.fuente.vista.semilla;
 
-                        // Revertir la rotación que no era correcta
-                        validacData[i] = rotacionIzq(validacData[i], j);
+        if (ranura.objetivos != nullptr){
+            etapas[etapa].objetivos = span<const uint8_t>(ranura.objetivos, tamVentana);
+        }
 
-                    }
+    }
 
-                }                
+    return true;
 
-            }
+}
 
-            if (validacion==true){
-                break;
-            }           
+void informarEtapa(const EtapaReconstruida& etapa, ostream& salida){
 
+    // Si sobrevive más de un candidato se informa en lugar de escoger en silencio el de mayor prioridad
+    if (!etapa.alternativas.empty()){
 
-            /* *************************************** Desplazamiento a la derecha ************************************** */
+        salida<<endl<<"Advertencia: la etapa "<<etapa.etapa+1<<" es ambigua, tambien coinciden:";
 
+        for (const AlternativaOperacion& alternativa : etapa.alternativas) {
+            salida<<endl<<"    "<<nombreOperacion(alternativa.operacion)<<(alternativa.equivalente ? " (equivalente)" : "");
+        }
 
-            for (int j=1;j<9;j++){
+        salida<<endl;
 
-                for (int i = 0; i < totalSize; i++) {
+    }
 
-                    // Original desplazar a la derecha
-                    validacData[i] = desplazamientoIzq(validacData[i], j);
+    if (etapa.operaciones.size() == 1){
+        salida<<endl<<nombreOperacion(etapa.operaciones[0])<<" en la etapa: "<<etapa.etapa+1<<endl;
+    }
+    else{
+        salida<<endl<<"Etapa compuesta: "<<nombreSecuencia(etapa.operaciones)<<" en la etapa: "<<etapa.etapa+1<<endl;
+    }
 
-                }
+}
 
-                enmascaramiento(validacData, wvalidacion, hvalidacion, maskData, wm,hm,seed1);
+void informarRetroceso(int etapaFallida, int desde, ostream& salida){
 
-                int n_pixels2=0;
+    // Las etapas que siguen ya se informaron; se vuelven a informar con las operaciones de la búsqueda
+    salida<<endl<<"Retroceso: la etapa "<<etapaFallida+1<<" no tiene solucion con las operaciones elegidas, se vuelve a revertir desde la etapa "<<desde+1<<endl;
 
-                unsigned int *validacionData = loadSeedMasking("Validacion.txt", seed1, n_pixels2);
+}
 
-                if (n_pixels2!=n_pixels1){
+void medirEtapa(const EtapaReconstruida& etapa, MetricasEtapa& medida, unsigned long long& reservasEtapa){
+    /*
+ * @brief Copia las mediciones de una etapa revertida; las reservas se cuentan desde la etapa anterior.
+ */
 
-                    //cout<<endl<<"No es operacion desplazamiento a la derecha de "<<j<<"bits en la etapa: "<<etapa+1<<endl;
-                    validacion=false;
-                }
+    unsigned long long reservas = reservasMemoria();
 
-                else{
+    medida.segundos[FASE_IDENTIFICACION] = etapa.segundosIdentificacion;
+    medida.segundos[FASE_BUSQUEDA] = etapa.segundosBusqueda;
+    medida.segundos[FASE_APLICACION] = etapa.segundosAplicacion;
+    medida.candidatos = etapa.candidatos;
+    medida.bytesRevisados = etapa.bytesRevisados;
+    medida.nodosBusqueda = etapa.nodosBusqueda;
 
-                    for (int k = 0; k < n_pixels2*3; k++) {
+    medida.reservas = reservas - reservasEtapa;
+    medida.picoMemoria = picoMemoriaResidente();
+    reservasEtapa = reservas;
 
-                        if (validacionData[k]!=maskingData1[k]){
-                            validacion=false;
-                            break;
-                        }
+}
 
-                        else{
-                            validacion=true;
-                        }
+bool informarResultado(const ResultadoReconstruccion& resultado, const OpcionesReconstruccion& opciones, ostream& salida){
+    /*
+ * @brief Informa por qué no se pudo reconstruir un caso.
+ *
+ * @return true si se reconstruyeron todas las etapas.
+ */
 
-                    }
+    switch (resultado.estado) {
 
-                    // Limpiar memoria dinámica
-                    if (validacionData != nullptr){
-                        delete[] validacionData;
-                        validacionData = nullptr;
-                    }
+    case RECONSTRUCCION_COMPLETA:
+        break;
 
-                }
+    // Asegurarse que las dimensiones coincidan: la XOR lee I_M en las mismas posiciones que la imagen
+    case RECONSTRUCCION_DIMENSIONES:
+        salida << "Las imagenes no tienen el mismo tamaño." << endl;
+        return false;
 
-                if (validacion==true){
+    case RECONSTRUCCION_SIN_PRESUPUESTO:
+        salida<<endl<<"No se encontro una reconstruccion dentro del presupuesto a partir de la etapa "<<resultado.etapaFallida+1;
+        salida<<" ("<<resultado.nodos<<" secuencias evaluadas en "<<resultado.milisegundos<<" ms)."<<endl;
+        return false;
 
-                    cout<<endl<<"Desplazamiento a la derecha de "<<j<<" bits en la etapa: "<<etapa+1<<endl;
+    case RECONSTRUCCION_SIN_SOLUCION:
+        salida<<endl<<"No existe una reconstruccion con hasta "<<opciones.configBusqueda.maxOperaciones<<" operaciones por etapa a partir de la etapa "<<resultado.etapaFallida+1;
+        salida<<" ("<<resultado.nodos<<" secuencias evaluadas en "<<resultado.milisegundos<<" ms)."<<endl;
+        return false;
 
-                    break;
+    }
 
-                }
+    return true;
 
-                else{
+}
 
-                    //cout<<endl<<"No es operacion desplazamiento a la derecha de "<<j<<"bits en la etapa: "<<etapa+1<<endl;
+void escribirMetricasCaso(MetricasCaso& metricas, bool reconstruido, const Cronometro& cronometro, unsigned long long reservasInicio, const RutasMetricas& rutasMetricas){
+    /*
+ * @brief Completa los totales del caso del modo interactivo y escribe --metrics-json / --metrics-prom.
+ */
 
-                    for (int i = 0; i < totalSize; i++) {
+    if (!rutasMetricas.activas()){
+        return;
+    }
 
-                        // Revertir operación incorrecta
-                        validacData[i] = desplazamientoDer(validacData[i], j);
+    RegistroMetricas registro;
+    string error;
 
-                    }
+    metricas.reconstruido = reconstruido;
+    metricas.segundosTotales = cronometro.segundos();
+    metricas.reservas = reservasMemoria() - reservasInicio;
+    metricas.picoMemoria = picoMemoriaResidente();
+    registro.agregar(metricas);
 
-                }                
+    if (!registro.escribir(rutasMetricas.json, rutasMetricas.prometheus, error)){
+        cout<<error<<endl;
+    }
 
-            }
+}
 
-            if (validacion==true){
-                break;
-            }            
 
+/* ********************************************* Reconstrucción por franjas ************************************************ */
 
-            /* **************************************** Desplazamiento a la iquierda ************************************** */
+bool reconstruirCasoPorFranjas(const CasoReconstruccion& caso, const string& rutaImask, const string& rutaMascara, PoolHilos& pool, const OpcionesReconstruccion& opciones, ostream& salida, MetricasCaso* metricas){
+    /*
+ * @brief Reconstruye un caso sin cargar completas la imagen de entrada ni I_M (--stream).
+ *
+ * Primero se identifican las operaciones de todas las etapas con solo las ventanas de enmascaramiento de ambas
+ * imágenes (reconstruirVentanas); después se recorre la imagen de a opciones.filasFranja filas: se leen la franja
+ * de la entrada y la de I_M, se les aplica la cadena de todas las operaciones (componerOperaciones) y se escribe
+ * la franja de la imagen final. La
+ * memoria depende del tamaño de la máscara y de la franja, no del de la imagen. El resultado es el mismo, byte
+ * a byte, que el de reconstruirCaso.
+ *
+ * Sin la imagen completa no se pueden exportar las imágenes de cada etapa ni Validacion.txt, así que
+ * --dump-stages y --dump-validation no se usan en este modo.
+ *
+ * @param rutaImask Archivo de I_M.
+ * @param rutaMascara Archivo de la máscara M (se carga completa).
+ *
+ * @return true si se reconstruyeron todas las etapas y se escribió la imagen final.
+ */
 
+    string error;
+    Cronometro cronometroCarga;
 
-            for (int j=1;j<9;j++){
+    ImagenRgb mascara;
+    LectorFranjasBmp lectorEntrada;
+    LectorFranjasBmp lectorImask;
 
-                for (int i = 0; i < totalSize; i++) {
+    if (!cargarRgb(rutaMascara.c_str(), mascara, error) || !lectorEntrada.abrir(caso.entrada.c_str(), error) || !lectorImask.abrir(rutaImask.c_str(), error)){
+        salida<<error<<endl;
+        return false;
+    }
 
-                    // Original desplazar a la izquierda
-                    validacData[i] = desplazamientoDer(validacData[i], j);
+    int ancho = lectorEntrada.ancho();
+    int alto = lectorEntrada.alto();
 
-                }
+    // Asegurarse que las dimensiones coincidan: la XOR lee I_M en las mismas posiciones que la imagen
+    if (lectorImask.ancho() != ancho || lectorImask.alto() != alto){
+        salida << "Las imagenes no tienen el mismo tamaño." << endl;
+        return false;
+    }
 
-                enmascaramiento(validacData, wvalidacion, hvalidacion, maskData, wm,hm,seed1);
+    if (metricas != nullptr){
+        metricas->segundos[FASE_CARGA_IMAGENES] += cronometroCarga.segundos();
+    }
 
-                int n_pixels2=0;
+    if (opciones.volcarEtapas || opciones.volcarValidacion){
+        salida<<endl<<"Advertencia: --dump-stages y --dump-validation no se usan con --stream."<<endl;
+    }
 
-                unsigned int *validacionData = loadSeedMasking("Validacion.txt", seed1, n_pixels2);
+    size_t tamVentana = (size_t)mascara.ancho*mascara.alto*3;
+    size_t bytesFila = (size_t)ancho*3;
 
-                if (n_pixels2!=n_pixels1){
+    vector<RanuraEnmascaramiento> ranuras;
+    vector<EtapaEnmascaramiento> etapas;
 
-                    //cout<<endl<<"No es operacion desplazamiento a la izquierda de "<<j<<"bits en la etapa: "<<etapa+1<<endl;
-                    validacion=false;
-                }
+    if (!cargarEtapas(caso, mascara.pixeles.data(), tamVentana, opciones, ranuras, etapas, salida, metricas)){
+        return false;
+    }
 
-                else{
+    // Solo las ventanas de enmascaramiento de la entrada y de I_M, una tras otra
+    VentanasCaso ubicacion = calcularVentanas(etapas, tamVentana, bytesFila*alto);
+    BufferAlineado ventanas = poolBuffers().obtener(ubicacion.bytes);
+    BufferAlineado imVentanas = poolBuffers().obtener(ubicacion.bytes);
+    size_t posicion = 0;
 
-                    for (int k = 0; k < n_pixels2*3; k++) {
+    Cronometro cronometroVentanas;
 
-                        if (validacionData[k]!=maskingData1[k]){
-                            validacion=false;
-                            break;
-                        }
+    for (const pair<size_t, size_t>& intervalo : ubicacion.intervalos) {
 
-                        else{
-                            validacion=true;
-                        }
+        if (!lectorEntrada.leerBytes(intervalo.first, intervalo.second, ventanas.data() + posicion, error) ||
+            !lectorImask.leerBytes(intervalo.first, intervalo.second, imVentanas.data() + posicion, error)){
+            salida<<error<<endl;
+            return false;
+        }
 
-                    }
+        posicion += intervalo.second - intervalo.first;
 
-                    // Limpiar memoria dinámica
-                    if (validacionData != nullptr){
-                        delete[] validacionData;
-                        validacionData = nullptr;
-                    }
+    }
 
-                }
+    if (metricas != nullptr){
+        metricas->segundos[FASE_CARGA_IMAGENES] += cronometroVentanas.segundos();
+        metricas->bytesLeidos += tamanoArchivo(rutaMascara) + 2*ubicacion.bytes;
+    }
 
-                if (validacion==true){
+    ConfiguracionReconstruccion config;
+    config.busquedaParalela = opciones.busquedaParalela;
+    config.busqueda = opciones.configBusqueda;
+    config.pool = &pool;
 
-                    cout<<endl<<"Desplazamiento a la izquierda de "<<j<<" bits en la etapa: "<<etapa+1<<endl;
+    ObservadorReconstruccion observador;
+    unsigned long long reservasEtapa = reservasMemoria();
 
-                    break;
+    observador.etapaRevertida = [&](const EtapaReconstruida& etapa, span<const uint8_t>){
 
-                }
+        informarEtapa(etapa, salida);
 
-                else{
+        if (metricas != nullptr){
+            medirEtapa(etapa, metricas->etapas[etapa.etapa], reservasEtapa);
+        }
 
-                    //cout<<endl<<"No es operacion desplazamiento a la izquierda de "<<j<<"bits en la etapa: "<<etapa+1<<endl;
+    };
 
-                    for (int i = 0; i < totalSize; i++) {
+    observador.retroceso = [&](int etapaFallida, int desde){
 
-                        // Revertir operación incorrecta
-                        validacData[i] = desplazamientoIzq(validacData[i], j);
+        informarRetroceso(etapaFallida, desde, salida);
 
-                    }
+    };
 
-                }
+    VistaImagen vistaMascara = {span<const uint8_t>(mascara.pixeles.data(), tamVentana), mascara.ancho, mascara.alto};
 
-            }
+    ResultadoReconstruccion resultado = reconstruirVentanas(span<uint8_t>(ventanas.data(), ubicacion.bytes), span<const uint8_t>(imVentanas.data(), ubicacion.bytes), ubicacion, ancho, vistaMascara, etapas, config, observador);
 
-            if (validacion==true){
-                break;
-            }           
+    ventanas.liberar();
+    imVentanas.liberar();
 
-        }
+    if (!informarResultado(resultado, opciones, salida)){
+        return false;
+    }
 
-        while(validacion==false);              
+    // Aplica las operaciones encontradas, compuestas en una sola cadena, de a una franja y la escribe en la imagen final
+    CadenaOperaciones cadena = componerOperaciones(resultado);
+    int filas = max(1, opciones.filasFranja);
 
-        if (etapa==0){
+    EscritorFranjasBmp escritorFinal;
+    BufferAlineado franja = poolBuffers().obtener(bytesFila*filas);
+    BufferAlineado imFranja = poolBuffers().obtener(bytesFila*filas);
 
-            // Exporta la imagen modificada a un nuevo archivo BMP
-            exportImage(validacData, width, height, "Final.bmp");
+    double segundosLectura = 0;
+    double segundosAplicacion = 0;
+    double segundosEscritura = 0;
 
-            // Muestra si la exportación fue exitosa (true o false)
-            //cout << exportFinal << endl;
-            cout<<endl;
+    if (!escritorFinal.abrir(caso.final.c_str(), ancho, alto, error)){
+        salida<<error<<endl;
+        return false;
+    }
 
-        }
+    for (int y = 0; y < alto; y += filas) {
 
-        else{
+        int filasFranja = min(filas, alto - y);
+        size_t bytes = bytesFila*filasFranja;
 
-            exportImage(validacData, width, height, archivosSalidaBMP[etapa-1]);
+        Cronometro cronometro;
 
+        if (!lectorEntrada.leerFilas(y, filasFranja, franja.data(), error) || !lectorImask.leerFilas(y, filasFranja, imFranja.data(), error)){
+            salida<<error<<endl;
+            return false;
         }
 
-        // Limpiar memoria dinámica
+        segundosLectura += cronometro.segundos();
+        cronometro = Cronometro();
 
-        if (maskingData1 != nullptr){
-            delete[] maskingData1;
-            maskingData1 = nullptr;
-        }
+        aplicarCadenaEnFranjas(pool, cadena, franja.data(), imFranja.data(), bytes, bytesFila);
 
-        delete [] pixelData;
-        pixelData = nullptr;
+        segundosAplicacion += cronometro.segundos();
+        cronometro = Cronometro();
 
-        delete [] validacData;
-        validacData = nullptr;
+        if (!escritorFinal.escribirFilas(y, filasFranja, franja.data(), error)){
+            salida<<"Error: No se pudo guardar la imagen BMP modificada ("<<error<<")."<<endl;
+            return false;
+        }
 
+        segundosEscritura += cronometro.segundos();
 
-    } // Fin del for
+    }
 
-    cout<<endl;
+    Cronometro cronometroCierre;
 
-    // Limpiar memoria dinámica
+    if (!escritorFinal.cerrar(error)){
+        salida<<"Error: No se pudo guardar la imagen BMP modificada ("<<error<<")."<<endl;
+        return false;
+    }
 
-    delete [] maskData;
-    maskData = nullptr;
+    if (metricas != nullptr){
+        metricas->segundos[FASE_CARGA_IMAGENES] += segundosLectura;
+        metricas->segundos[FASE_APLICACION] += segundosAplicacion;
+        metricas->segundos[FASE_EXPORTACION] += segundosEscritura + cronometroCierre.segundos();
+        metricas->bytesLeidos += tamanoArchivo(caso.entrada) + tamanoArchivo(rutaImask);
+        metricas->bytesEscritos += bytesBmp(ancho, alto);
+    }
 
-    delete [] ImaskData;
-    ImaskData = nullptr;
+    salida<<endl;
+
+    return true;
 
-    return 0; // Fin del programa
 }
 
 
-/* ************************************************** Funiciones *********************************************************** */
+/* ********************************************* Reconstrucción por lotes ************************************************ */
 
-unsigned char* loadPixels(QString input, int &width, int &height){
+bool descubrirCaso(const string& directorio, CasoReconstruccion& caso, string& error){
     /*
- * @brief Carga una imagen BMP desde un archivo y extrae los datos de píxeles en formato RGB.
- *
- * Esta función utiliza la clase QImage de Qt para abrir una imagen en formato BMP, convertirla al
- * formato RGB888 (24 bits: 8 bits por canal), y copiar sus datos de píxeles a un arreglo dinámico
- * de tipo unsigned char. El arreglo contendrá los valores de los canales Rojo, Verde y Azul (R, G, B)
- * de cada píxel de la imagen, sin rellenos (padding).
+ * @brief Arma la lista de archivos de un caso a partir del contenido de su directorio.
  *
- * @param input Ruta del archivo de imagen BMP a cargar (tipo QString).
- * @param width Parámetro de salida que contendrá el ancho de la imagen cargada (en píxeles).
- * @param height Parámetro de salida que contendrá la altura de la imagen cargada (en píxeles).
- * @return Puntero a un arreglo dinámico que contiene los datos de los píxeles en formato RGB.
- *         Devuelve nullptr si la imagen no pudo cargarse.
+ * El directorio debe tener I_D.bmp, I_M.bmp, M.bmp y los archivos de enmascaramiento M0, M1, ... (.txt o .bin).
+ * El número de etapas es la cantidad de archivos M consecutivos desde M0, sin límite. Las salidas (Final.bmp,
+ * Etapa*.bmp y Validacion.txt) se escriben en el mismo directorio.
  *
- * @note Es responsabilidad del usuario liberar la memoria asignada al arreglo devuelto usando `delete[]`.
+ * @return false si el directorio no tiene M0.
  */
 
-    // Cargar la imagen BMP desde el archivo especificado (usando Qt)
-    QImage imagen(input);
+    string base = directorio;
 
-    // Verifica si la imagen fue cargada correctamente
-    if (imagen.isNull()) {
-        cout << "Error: No se pudo cargar la imagen BMP." << std::endl;
-        return nullptr; // Retorna un puntero nulo si la carga falló
+    if (!base.empty() && base.back() != '/' && base.back() != '\\'){
+        base += '/';
     }
 
-    // Convierte la imagen al formato RGB888 (3 canales de 8 bits sin transparencia)
-    imagen = imagen.convertToFormat(QImage::Format_RGB888);
-
-    // Obtiene el ancho y el alto de la imagen cargada
-    width = imagen.width();
-    height = imagen.height();
-
-    //cout<<endl<<"Ancho: "<<width<<" "<<"Alto: "<<height<<endl;
+    caso = CasoReconstruccion();
+    caso.entrada = base + "I_D.bmp";
+    caso.rutaImask = base + "I_M.bmp";
+    caso.rutaMascara = base + "M.bmp";
+    caso.validacion = base + "Validacion.txt";
+    caso.final = base + "Final.bmp";
 
-    // Calcula el tamaño total de datos (3 bytes por píxel: R, G, B)
-    int dataSize = width * height * 3;
+    for (int etapa = 0; ; etapa++) {
 
-    // Reserva memoria dinámica para almacenar los valores RGB de cada píxel
-    unsigned char* pixelData = new unsigned char[dataSize];
+        string nombre = base + "M" + to_string(etapa);
 
-    //cout<<endl<<"pixel Data: "<<*(pixelData+3)<<endl;
+        if (!existeArchivo(nombre + ".txt") && !existeArchivo(nombre + ".bin")){
+            break;
+        }
 
-    // Copia cada línea de píxeles de la imagen Qt a nuestro arreglo lineal
-    for (int y = 0; y < height; ++y) {
-        const uchar* srcLine = imagen.scanLine(y);              // Línea original de la imagen con posible padding
-        unsigned char* dstLine = pixelData + y * width * 3;     // Línea destino en el arreglo lineal sin padding
-        memcpy(dstLine, srcLine, width * 3);                    // Copia los píxeles RGB de esa línea (sin padding)
+        caso.enmascaramientos.push_back(nombre + ".txt");
+        caso.salidasEtapas.push_back(base + "Etapa" + to_string(etapa + 1) + ".bmp");
 
-        //cout<<endl<<"dstLine: "<<*(dstLine)<<endl;
     }
 
-    // Retorna el puntero al arreglo de datos de píxeles cargado en memoria
-    //cout<<endl<<"pixel Data: "<<(pixelData)<<endl;
+    if (caso.enmascaramientos.empty()){
+        error = directorio + ": no hay archivos de enmascaramiento (M0.txt)";
+        return false;
+    }
 
-    return pixelData;
+    return true;
 
 }
 
-bool exportImage(unsigned char* pixelData, int width,int height, QString archivoSalida){
+bool reconstruirDirectorio(const string& directorio, CasoReconstruccion& caso, CacheImagenes& cache, PoolHilos& pool, EscritorImagenes& escritor, const OpcionesReconstruccion& opciones, ostream& informe, MetricasCaso* metricas){
     /*
- * @brief Exporta una imagen en formato BMP a partir de un arreglo de píxeles en formato RGB.
- *
- * Esta función crea una imagen de tipo QImage utilizando los datos contenidos en el arreglo dinámico
- * `pixelData`, que debe representar una imagen en formato RGB888 (3 bytes por píxel, sin padding).
- * A continuación, copia los datos línea por línea a la imagen de salida y guarda el archivo resultante
- * en formato BMP en la ruta especificada.
- *
- * @param pixelData Puntero a un arreglo de bytes que contiene los datos RGB de la imagen a exportar.
- *                  El tamaño debe ser igual a width * height * 3 bytes.
- * @param width Ancho de la imagen en píxeles.
- * @param height Alto de la imagen en píxeles.
- * @param archivoSalida Ruta y nombre del archivo de salida en el que se guardará la imagen BMP (QString).
+ * @brief Reconstruye el caso de un directorio, con I_M y M tomadas de la caché.
  *
- * @return true si la imagen se guardó exitosamente; false si ocurrió un error durante el proceso.
+ * @param caso Recibe los archivos del caso (ver descubrirCaso).
+ * @param informe Recibe el informe de la reconstrucción y los errores.
+ * @param metricas Si se indica, recibe las mediciones del caso (ver reconstruirCaso); los bytes leídos de I_M y M
+ *                 no se cuentan, porque pueden venir de la caché.
  *
- * @note La función no libera la memoria del arreglo pixelData; esta responsabilidad recae en el usuario.
+ * @return true si el caso se reconstruyó.
  */
 
-    // Crear una nueva imagen de salida con el mismo tamaño que la original
-    // usando el formato RGB888 (3 bytes por píxel, sin canal alfa)
-    QImage outputImage(width, height, QImage::Format_RGB888);
+    string error;
 
-    // Copiar los datos de píxeles desde el buffer al objeto QImage
-    for (int y = 0; y < height; ++y) {
-        // outputImage.scanLine(y) devuelve un puntero a la línea y-ésima de píxeles en la imagen
-        // pixelData + y * width * 3 apunta al inicio de la línea y-ésima en el buffer (sin padding)
-        // width * 3 son los bytes a copiar (3 por píxel)
-        memcpy(outputImage.scanLine(y), pixelData + y * width * 3, width * 3);
+    shared_ptr<const ImagenRgb> imask;
+    shared_ptr<const ImagenRgb> mascara;
+    ImagenRgb imagen;
+
+    if (!descubrirCaso(directorio, caso, error)){
+        informe<<error<<endl;
+        return false;
     }
 
-    // Guardar la imagen en disco como archivo BMP
-    if (!outputImage.save(archivoSalida, "BMP")) {
-        // Si hubo un error al guardar, mostrar mensaje de error
-        cout << "Error: No se pudo guardar la imagen BMP modificada.";
-        return false; // Indica que la operación falló
-    } else {
-        // Si la imagen fue guardada correctamente, mostrar mensaje de éxito
-        //cout << "Imagen BMP modificada guardada como " << archivoSalida.toStdString() << endl;
-        return true; // Indica éxito
+    // Con --stream las imágenes no pasan por la caché: se leen de a franjas
+    if (opciones.porFranjas){
+        informe<<caso.enmascaramientos.size()<<" etapas"<<endl;
+        return reconstruirCasoPorFranjas(caso, caso.rutaImask, caso.rutaMascara, pool, opciones, informe, metricas);
     }
 
+    Cronometro cronometro;
+
+    if (!(imask = cache.obtener(caso.rutaImask, error)) || !(mascara = cache.obtener(caso.rutaMascara, error)) || !cargarRgb(caso.entrada.c_str(), imagen, error)){
+        informe<<error<<endl;
+        return false;
+    }
+
+    if (metricas != nullptr){
+        metricas->segundos[FASE_CARGA_IMAGENES] += cronometro.segundos();
+        metricas->bytesLeidos += tamanoArchivo(caso.entrada);
+    }
+
+    informe<<caso.enmascaramientos.size()<<" etapas"<<endl;
+
+    return reconstruirCaso(caso, imagen.pixeles.data(), imagen.ancho, imagen.alto, imask->pixeles.data(), imask->ancho, imask->alto, mascara->pixeles.data(), mascara->ancho, mascara->alto, pool, escritor, opciones, informe, metricas);
+
 }
 
-unsigned int* loadSeedMasking(const char* nombreArchivo, int &seed, int &n_pixels){
+int reconstruirLote(const vector<string>& directorios, int cantidadHilos, const OpcionesReconstruccion& opciones, const RutasMetricas& rutasMetricas){
     /*
- * @brief Carga la semilla y los resultados del enmascaramiento desde un archivo de texto.
- *
- * Esta función abre un archivo de texto que contiene una semilla en la primera línea y,
- * a continuación, una lista de valores RGB resultantes del proceso de enmascaramiento.
- * Primero cuenta cuántos tripletes de píxeles hay, luego reserva memoria dinámica
- * y finalmente carga los valores en un arreglo de enteros.
+ * @brief Reconstruye varios casos sin interacción, repartiéndolos entre los hilos del pool.
  *
- * @param nombreArchivo Ruta del archivo de texto que contiene la semilla y los valores RGB.
- * @param seed Variable de referencia donde se almacenará el valor entero de la semilla.
- * @param n_pixels Variable de referencia donde se almacenará la cantidad de píxeles leídos
- *                 (equivalente al número de líneas después de la semilla).
+ * Cada caso se reconstruye completo en un hilo (sus operaciones sobre la imagen no se reparten, porque el pool
+ * no admite trabajos anidados); con un solo caso se usan todos los hilos dentro de él. Las imágenes I_M y M
+ * pasan por una caché por archivo, así que los casos que usan los mismos archivos comparten un solo buffer.
+ * El informe de cada caso se acumula aparte y se imprime completo al terminar el caso.
  *
- * @return Puntero a un arreglo dinámico de enteros que contiene los valores RGB
- *         en orden secuencial (R, G, B, R, G, B, ...). Devuelve nullptr si ocurre un error al abrir el archivo.
+ * @param directorios Directorios de los casos (ver descubrirCaso).
+ * @param cantidadHilos Hilos del pool (0 = los que reporte el sistema).
+ * @param opciones Opciones de la línea de comandos.
+ * @param rutasMetricas Archivos donde se escriben las mediciones de todos los casos al terminar.
  *
- * @note Es responsabilidad del usuario liberar la memoria reservada con delete[].
+ * @return 0 si todos los casos se reconstruyeron, 1 si alguno falló.
  */
 
-    // Abrir el archivo que contiene la semilla y los valores RGB
-    ifstream archivo(nombreArchivo);
-    if (!archivo.is_open()) {
-        // Verificar si el archivo pudo abrirse correctamente
-        cout << "No se pudo abrir el archivo." << endl;
-        return nullptr;
-    }
+    int casos = (int)directorios.size();
+    bool casosEnParalelo = (casos > 1);
+
+    PoolHilos pool(cantidadHilos);
+    CacheImagenes cache;
+    EscritorImagenes escritor;
 
-    // Leer la semilla desde la primera línea del archivo
-    archivo >> seed;
+    mutex candadoSalida;
+    atomic<int> reconstruidos(0);
+    RegistroMetricas registro;
 
-    int r, g, b;
+    auto reconstruirUno = [&](int i){
 
-    // Contar cuántos grupos de valores RGB hay en el archivo
-    // Se asume que cada línea después de la semilla tiene tres valores (r, g, b)
-    while (archivo >> r >> g >> b) {
-        n_pixels++;  // Contamos la cantidad de píxeles
+        ostringstream informe;
+        CasoReconstruccion caso;
+        MetricasCaso metricas;
+        unsigned long long reservasInicio = reservasMemoria();
+        Cronometro cronometro;
+
+        // Dentro de un caso que corre en un hilo del pool las franjas se procesan en ese mismo hilo
+        PoolHilos serial(1);
+
+        bool reconstruido = reconstruirDirectorio(directorios[i], caso, cache, casosEnParalelo ? serial : pool, escritor, opciones, informe, &metricas);
+
+        if (reconstruido){
+            reconstruidos++;
+        }
+
+        metricas.nombre = directorios[i];
+        metricas.reconstruido = reconstruido;
+        metricas.segundosTotales = cronometro.segundos();
+        metricas.reservas = reservasMemoria() - reservasInicio;
+        metricas.picoMemoria = picoMemoriaResidente();
+        registro.agregar(metricas);
+
+        lock_guard<mutex> guardia(candadoSalida);
+        cout<<endl<<"== "<<directorios[i]<<(reconstruido ? "" : " (error)")<<" =="<<endl<<informe.str();
+
+    };
+
+    if (casosEnParalelo){
+        pool.ejecutar(casos, reconstruirUno);
+    }
+    else{
+        reconstruirUno(0);
     }
 
-    // Cerrar el archivo para volver a abrirlo desde el inicio
-    archivo.close();
-    archivo.open(nombreArchivo);
+    vector<string> erroresEscritura;
+    bool escrito = escritor.esperar(erroresEscritura);
 
-    // Verificar que se pudo reabrir el archivo correctamente
-    if (!archivo.is_open()) {
-        cout << "Error al reabrir el archivo." << endl;
-        return nullptr;
+    for (const string& error : erroresEscritura) {
+        cout<<"Error: No se pudo guardar la imagen BMP modificada ("<<error<<")."<<endl;
     }
 
-    // Reservar memoria dinámica para guardar todos los valores RGB
-    // Cada píxel tiene 3 componentes: R, G y B
-    unsigned int* RGB = new unsigned int[n_pixels * 3];
+    cout<<endl<<reconstruidos.load()<<" de "<<casos<<" casos reconstruidos ("<<cache.cargadas()<<" imagenes I_M/M distintas, "<<cache.reutilizadas()<<" reutilizadas)."<<endl;
 
-    // Leer nuevamente la semilla desde el archivo (se descarta su valor porque ya se cargó antes)
-    archivo >> seed;
+    string error;
 
-    // Leer y almacenar los valores RGB uno por uno en el arreglo dinámico
-    for (int i = 0; i < n_pixels * 3; i += 3) {
-        archivo >> r >> g >> b;
-        RGB[i] = r;
-        RGB[i + 1] = g;
-        RGB[i + 2] = b;
+    if (rutasMetricas.activas() && !registro.escribir(rutasMetricas.json, rutasMetricas.prometheus, error)){
+        cout<<error<<endl;
     }
 
-    // Cerrar el archivo después de terminar la lectura
-    archivo.close();
-
-    // Mostrar información de control en consola
-    //cout << "Semilla: " << seed << endl;
-    //cout << "Cantidad de pixeles leidos: " << n_pixels << endl;
+    return (reconstruidos.load() == casos && escrito) ? 0 : 1;
 
-    // Retornar el puntero al arreglo con los datos RGB
-    return RGB;
 }
 
-unsigned char desplazamientoIzq(unsigned char Id, int n){
 
-    return Id << n;
+/* ********************************************* Modo servidor ************************************************ */
 
-}
+int servirReconstrucciones(const string& rutaSocket, int cantidadHilos, size_t capacidadCache, const OpcionesReconstruccion& opciones, const RutasMetricas& rutasMetricas){
+    /*
+ * @brief Atiende pedidos de reconstrucción por un socket Unix, manteniendo I_M y M en una caché entre pedidos.
+ *
+ * Los pedidos de varias conexiones se reconstruyen a la vez y comparten el pool de hilos (cuyos trabajos se
+ * ejecutan de a uno) y la caché, que conserva las capacidadCache imágenes usadas más recientemente. Cada pedido
+ * tiene su propio escritor de imágenes y espera a que la imagen final esté en disco antes de responder.
+ *
+ * @param rutaSocket Ruta del socket.
+ * @param cantidadHilos Hilos del pool (0 = los que reporte el sistema).
+ * @param capacidadCache Imágenes I_M/M distintas que se conservan (0 = sin límite).
+ * @param opciones Opciones de la línea de comandos, iguales para todos los pedidos.
+ * @param rutasMetricas Archivos de mediciones; se reescriben después de cada pedido con el último de cada caso
+ *                      (el directorio o, para los pedidos INLINE, la imagen final).
+ *
+ * @return 0 si el servidor se detuvo con SALIR, 1 si no se pudo abrir el socket.
+ */
 
-unsigned char desplazamientoDer(unsigned char Id, int n){
+    PoolHilos pool(cantidadHilos);
+    CacheImagenes cache(capacidadCache);
 
-    return Id >> n;
+    RegistroMetricas registro(MAX_CASOS_METRICAS_SERVIDOR);
+    mutex candadoMetricas;
 
-}
+    auto atender = [&](PedidoReconstruccion& pedido, ostream& informe, string& archivoFinal){
 
-unsigned char rotacionIzq(unsigned char Id, int n){
+        EscritorImagenes escritor;
+        CasoReconstruccion caso;
+        MetricasCaso metricas;
+        unsigned long long reservasInicio = reservasMemoria();
+        Cronometro cronometro;
+        bool reconstruido;
 
-    return (Id << n) | (Id >> (8 - n));
+        if (!pedido.directorio.empty()){
+            metricas.nombre = pedido.directorio;
+            reconstruido = reconstruirDirectorio(pedido.directorio, caso, cache, pool, escritor, opciones, informe, &metricas);
+        }
+        else{
 
-}
+            string error;
+            ImagenRgb imagen;
+            shared_ptr<const ImagenRgb> imask = cache.obtener((const unsigned char*)pedido.imask.data(), pedido.imask.size(), "I_M.bmp", error);
+            shared_ptr<const ImagenRgb> mascara = imask ? cache.obtener((const unsigned char*)pedido.mascara.data(), pedido.mascara.size(), "M.bmp", error) : nullptr;
 
-unsigned char rotacionDer(unsigned char Id, int n){
+            if (!mascara || !cargarRgb((const unsigned char*)pedido.imagen.data(), pedido.imagen.size(), "I_D.bmp", imagen, error)){
+                informe<<error<<endl;
+                return false;
+            }
 
-    return (Id >> n) | (Id << (8 - n));
+            metricas.nombre = pedido.salida;
+            metricas.segundos[FASE_CARGA_IMAGENES] = cronometro.segundos();
 
-}
+            // Las salidas de --dump-stages y --dump-validation van al directorio de la imagen final
+            size_t separador = pedido.salida.find_last_of("/\\");
+            string base = (separador == string::npos) ? "" : pedido.salida.substr(0, separador + 1);
 
-unsigned char operacionXor(unsigned char Id, unsigned char IM){
+            caso.entrada = "I_D.bmp";
+            caso.validacion = base + "Validacion.txt";
+            caso.final = pedido.salida;
+            caso.contenidos = move(pedido.enmascaramientos);
 
-    return Id ^ IM;
+            for (size_t etapa = 0; etapa < caso.contenidos.size(); etapa++) {
+                caso.enmascaramientos.push_back("M" + to_string(etapa) + ".txt");
+                caso.salidasEtapas.push_back(base + "Etapa" + to_string(etapa + 1) + ".bmp");
+            }
 
-}
+            informe<<caso.enmascaramientos.size()<<" etapas"<<endl;
+            reconstruido = reconstruirCaso(caso, imagen.pixeles.data(), imagen.ancho, imagen.alto, imask->pixeles.data(), imask->ancho, imask->alto, mascara->pixeles.data(), mascara->ancho, mascara->alto, pool, escritor, opciones, informe, &metricas);
+
+        }
 
-unsigned char* revertirEnmas(unsigned int* sumaRGB, unsigned char* M, int i, int j){
+        vector<string> erroresEscritura;
+        bool escrito = escritor.esperar(erroresEscritura);
 
-    if (i<=0 || j<=0){
-        return nullptr;
-    }
+        if (rutasMetricas.activas()){
 
+            string error;
 
-    unsigned char* original = new unsigned char[i*j*3];
+            metricas.reconstruido = reconstruido && escrito;
+            metricas.segundosTotales = cronometro.segundos();
+            metricas.reservas = reservasMemoria() - reservasInicio;
+            metricas.picoMemoria = picoMemoriaResidente();
+            registro.agregar(metricas);
 
-    for (int k=0;k<(i*j*3);k++){
+            // Dos pedidos que terminan a la vez no deben escribir el mismo archivo temporal
+            lock_guard<mutex> guardia(candadoMetricas);
 
-        int valor=(int)sumaRGB[k]-(int)M[k];
+            if (!registro.escribir(rutasMetricas.json, rutasMetricas.prometheus, error)){
+                informe<<error<<endl;
+            }
 
-        if (valor < 0){
-            valor += 256;  // Evitar desbordamiento negativo
         }
 
-        original[k] = (unsigned char)(valor);
+        if (!escrito){
 
-    }
+            for (const string& error : erroresEscritura) {
+                informe<<"Error: No se pudo guardar la imagen BMP modificada ("<<error<<")."<<endl;
+            }
+
+            return false;
+
+        }
+
+        archivoFinal = caso.final;
+
+        return reconstruido;
+
+    };
+
+    auto estado = [&](ostream& salida){
+
+        salida<<cache.cargadas()<<" imagenes I_M/M en cache (capacidad "<<capacidadCache<<")"<<endl;
+        salida<<cache.reutilizadas()<<" reutilizadas, "<<cache.descartadas()<<" descartadas"<<endl;
+        salida<<poolBuffers().reservados()<<" buffers de imagen reservados, "<<poolBuffers().reutilizados()<<" reutilizados"<<endl;
+
+    };
 
-    return original;
+    return ejecutarServidor(rutaSocket, atender, estado);
 
 }
 
-void enmascaramiento(unsigned char* Id, int wId, int hId, unsigned char* M, int wM, int hM, int s){
 
-    int totalId=wId*hId*3;
-    int totalM=wM*hM*3;
+/* ************************************************** Funiciones *********************************************************** */
+
+BufferAlineado loadPixels(const string& input, int &width, int &height){
+    /*
+ * @brief Carga una imagen BMP desde un archivo y extrae los datos de píxeles en formato RGB.
+ *
+ * El archivo se proyecta en memoria con ImagenBmp y sus píxeles se copian una sola vez a un buffer de
+ * poolBuffers() (alineado a 64 bytes y, con --huge-pages, en páginas de 2 MiB), convirtiendo de BGR a RGB y
+ * ordenando las filas de arriba hacia abajo, igual que cargarRgb en --batch. El arreglo
+ * contendrá los valores de los canales Rojo, Verde y Azul (R, G, B) de cada píxel de la imagen, sin rellenos
+ * (padding). Si el BMP usa un formato que el lector propio no soporta (por ejemplo, compresión RLE) y el
+ * programa se compiló con Qt, se intenta con QImage.
+ *
+ * @param input Ruta del archivo de imagen BMP a cargar.
+ * @param width Parámetro de salida que contendrá el ancho de la imagen cargada (en píxeles).
+ * @param height Parámetro de salida que contendrá la altura de la imagen cargada (en píxeles).
+ * @return Buffer con los datos de los píxeles en formato RGB; vacío (data() == nullptr) si la imagen no pudo
+ *         cargarse. Vuelve al pool al destruirse.
+ */
+
+    ImagenBmp bmp;
+    string error;
+
+    if (bmp.abrir(input.c_str(), error)) {
+
+        width = bmp.vista().ancho;
+        height = bmp.vista().alto;
+
+        BufferAlineado pixeles = poolBuffers().obtener((size_t)width * 3 * height);
+        copiarRgb(bmp.vista(), pixeles.data());
+
+        return pixeles;
 
-    // Validar tamaños
-    if (totalId < totalM) {
-        cout << "Error: La imagen ID es más pequeña que la máscara M." << endl;
-        return;
     }
 
-    // Abrir archivo para guardar salida
-    ofstream archivo("Validacion.txt");
-    if (!archivo.is_open()) {
-        cout << "No se pudo abrir el archivo de salida." << endl;
-        return;
+#ifdef SIN_QT
+
+    cout << "Error: No se pudo cargar la imagen BMP (" << error << ")." << std::endl;
+    return BufferAlineado();
+
+#else
+
+    // Cargar la imagen BMP desde el archivo especificado (usando Qt)
+    QImage imagen(QString::fromStdString(input));
+
+    // Verifica si la imagen fue cargada correctamente
+    if (imagen.isNull()) {
+        cout << "Error: No se pudo cargar la imagen BMP." << std::endl;
+        return BufferAlineado(); // Retorna un buffer vacío si la carga falló
     }
 
-    // Escribir la semilla en la primera línea
-    archivo << s << endl;
+    // Convierte la imagen al formato RGB888 (3 canales de 8 bits sin transparencia)
+    imagen = imagen.convertToFormat(QImage::Format_RGB888);
+
+    // Obtiene el ancho y el alto de la imagen cargada
+    width = imagen.width();
+    height = imagen.height();
+
+    // Calcula el tamaño total de datos (3 bytes por píxel: R, G, B)
+    size_t dataSize = (size_t)width * height * 3;
 
-    // Calcular y guardar las sumas S(k) = ID(k + s) + M(k)
-    for (int k = 0; k < totalM; k += 3) {
-        int r = (int)Id[s + k]     +(int)M[k];
-        int g = (int)Id[s + k + 1] + (int)M[k + 1];
-        int b = (int)Id[s + k + 2] + (int)M[k + 2];
+    // Reserva un buffer alineado del pool para almacenar los valores RGB de cada píxel
+    BufferAlineado pixeles = poolBuffers().obtener(dataSize);
+    unsigned char* pixelData = pixeles.data();
 
-        archivo << r << " " << g << " " << b << endl;
+    // Copia cada línea de píxeles de la imagen Qt a nuestro arreglo lineal
+    for (int y = 0; y < height; ++y) {
+        const uchar* srcLine = imagen.scanLine(y);              // Línea original de la imagen con posible padding
+        unsigned char* dstLine = pixelData + (size_t)y * width * 3;     // Línea destino en el arreglo lineal sin padding
+        memcpy(dstLine, srcLine, (size_t)width * 3);                    // Copia los píxeles RGB de esa línea (sin padding)
     }
 
-    archivo.close();
-    //cout << "Enmascaramiento completado. Archivo guardado: " << "Validacion.txt"<< endl;
+    return pixeles;
+
+#endif
 
 }
 
+bool exportImage(unsigned char* pixelData, int width,int height, const string& archivoSalida, EscritorImagenes* escritor){
+    /*
+ * @brief Exporta una imagen en formato BMP a partir de un arreglo de píxeles en formato RGB.
+ *
+ * Los datos de `pixelData`, que deben representar una imagen en formato RGB888 (3 bytes por píxel, sin padding),
+ * se guardan con escribirBmp como BMP de 24 bits en la ruta especificada.
+ *
+ * @param pixelData Puntero a un arreglo de bytes que contiene los datos RGB de la imagen a exportar.
+ *                  El tamaño debe ser igual a width * height * 3 bytes.
+ * @param width Ancho de la imagen en píxeles.
+ * @param height Alto de la imagen en píxeles.
+ * @param archivoSalida Ruta y nombre del archivo de salida en el que se guardará la imagen BMP.
+ * @param escritor Si se indica, la imagen se codifica y su escritura queda en el hilo del escritor; los errores
+ *                 se informan al llamar a escritor->esperar().
+ *
+ * @return true si la imagen se guardó (o se encoló) exitosamente; false si ocurrió un error durante el proceso.
+ *
+ * @note La función no libera la memoria del arreglo pixelData; esta responsabilidad recae en el usuario.
+ */
+
+    if (escritor != nullptr) {
+        return escritor->encolar(archivoSalida, pixelData, width, height);
+    }
 
+    string error;
 
+    // Guardar la imagen en disco como archivo BMP
+    if (!escribirBmp(archivoSalida.c_str(), pixelData, width, height, error)) {
+        // Si hubo un error al guardar, mostrar mensaje de error
+        cout << "Error: No se pudo guardar la imagen BMP modificada (" << error << ").";
+        return false; // Indica que la operación falló
+    }
+
+    return true; // Indica éxito
 
+}
 
+size_t bytesBmp(int width, int height){
+    /*
+ * @brief Tamaño del archivo BMP de 24 bits que escribe exportImage: cabeceras y filas rellenadas a 4 bytes.
+ */
 
+    return 54 + (((size_t)width*3 + 3) & ~(size_t)3)*height;
+
+}
 
+bool convertirEnmascaramiento(const char* entrada, const char* salida, const string& mascara, bool preimagenes){
+    /*
+ * @brief Convierte un archivo de enmascaramiento M*.txt al formato binario (.bin).
+ *
+ * El archivo binario se proyecta en memoria al reconstruir, sin convertir texto. Con preimagenes = true guarda
+ * directamente los bytes S(k) - M(k) que debe tener la imagen transformada, por lo que solo sirve con la misma
+ * máscara; la conversión falla si alguna suma no tiene preimagen.
+ *
+ * @param entrada Archivo .txt de entrada.
+ * @param salida Archivo .bin de salida.
+ * @param mascara Imagen de la máscara M (da sus dimensiones y, para las preimágenes, sus bytes).
+ * @param preimagenes true para guardar S(k) - M(k) como bytes en lugar de las sumas.
+ *
+ * @return true si el archivo se convirtió.
+ */
+
+    int wm=0;
+    int hm=0;
+
+    BufferAlineado bufferMascara = loadPixels(mascara, wm, hm);
+    unsigned char *maskData = bufferMascara.data();
+
+    if (maskData == nullptr){
+        return false;
+    }
+
+    DatosEnmascaramiento datos;
+    string error;
+
+    bool convertido = leerEnmascaramiento(entrada, datos, error) && escribirEnmascaramientoBinario(salida, datos, maskData, wm, hm, preimagenes, error);
+
+    if (convertido){
+        cout<<entrada<<" -> "<<salida<<" ("<<datos.sumas.size()<<" valores"<<(preimagenes ? ", preimagenes" : "")<<")"<<endl;
+    }
+    else{
+        cout<<error<<endl;
+    }
+
+    return convertido;
+
+}
@@ -0,0 +1,335 @@
+#include "memoria.h"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+
+/* ************************************************** Reserva del sistema *********************************************************** */
+
+static size_t redondear(size_t bytes, size_t multiplo){
+
+    return (bytes + multiplo - 1) / multiplo * multiplo;
+
+}
+
+static unsigned char* reservarPaginasGrandes(size_t& capacidad){
+    /*
+ * @brief Reserva en páginas grandes; nullptr si el sistema no las da (sin páginas reservadas, sin privilegio...).
+ */
+
+#if defined(_WIN32)
+
+    // Requiere el privilegio SeLockMemoryPrivilege; sin él VirtualAlloc falla y se usa la reserva normal
+    size_t pagina = GetLargePageMinimum();
+
+    if (pagina == 0) {
+        return nullptr;
+    }
+
+    size_t bytes = redondear(capacidad, pagina);
+    void* memoria = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+
+    if (memoria == nullptr) {
+        return nullptr;
+    }
+
+    capacidad = bytes;
+
+    return (unsigned char*)memoria;
+
+#else
+
+    size_t bytes = redondear(capacidad, BYTES_PAGINA_GRANDE);
+    void* memoria = MAP_FAILED;
+
+    // Primero las páginas grandes reservadas (hugetlbfs); si no hay, páginas normales con la sugerencia de
+    // agruparlas (transparent huge pages)
+#ifdef MAP_HUGETLB
+    memoria = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+
+    if (memoria == MAP_FAILED) {
+
+        memoria = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (memoria == MAP_FAILED) {
+            return nullptr;
+        }
+
+#ifdef MADV_HUGEPAGE
+        madvise(memoria, bytes, MADV_HUGEPAGE);
+#endif
+
+    }
+
+    capacidad = bytes;
+
+    return (unsigned char*)memoria;
+
+#endif
+
+}
+
+static unsigned char* reservarMemoria(size_t& capacidad, bool grandes, bool& mapeado){
+
+    if (grandes) {
+
+        unsigned char* memoria = reservarPaginasGrandes(capacidad);
+
+        if (memoria != nullptr) {
+            mapeado = true;
+            return memoria;
+        }
+
+    }
+
+    mapeado = false;
+    capacidad = redondear(capacidad, ALINEACION_BUFFER);
+
+#ifdef _WIN32
+    void* memoria = _aligned_malloc(capacidad, ALINEACION_BUFFER);
+#else
+    void* memoria = aligned_alloc(ALINEACION_BUFFER, capacidad);
+#endif
+
+    if (memoria == nullptr) {
+        throw bad_alloc();
+    }
+
+    return (unsigned char*)memoria;
+
+}
+
+static void liberarMemoria(unsigned char* datos, size_t capacidad, bool mapeado){
+
+    if (mapeado) {
+#ifdef _WIN32
+        (void)capacidad;
+        VirtualFree(datos, 0, MEM_RELEASE);
+#else
+        munmap(datos, capacidad);
+#endif
+        return;
+    }
+
+#ifdef _WIN32
+    _aligned_free(datos);
+#else
+    free(datos);
+#endif
+
+}
+
+
+/* ************************************************** Buffer *********************************************************** */
+
+BufferAlineado::~BufferAlineado(){
+
+    liberar();
+
+}
+
+BufferAlineado::BufferAlineado(BufferAlineado&& otro) noexcept
+    : datos(otro.datos), tam(otro.tam), capacidad(otro.capacidad), mapeado(otro.mapeado), pool(otro.pool){
+
+    otro.datos = nullptr;
+    otro.tam = 0;
+    otro.capacidad = 0;
+    otro.pool = nullptr;
+
+}
+
+BufferAlineado& BufferAlineado::operator=(BufferAlineado&& otro) noexcept{
+
+    if (this != &otro) {
+
+        liberar();
+
+        datos = otro.datos;
+        tam = otro.tam;
+        capacidad = otro.capacidad;
+        mapeado = otro.mapeado;
+        pool = otro.pool;
+
+        otro.datos = nullptr;
+        otro.tam = 0;
+        otro.capacidad = 0;
+        otro.pool = nullptr;
+
+    }
+
+    return *this;
+
+}
+
+void BufferAlineado::liberar(){
+
+    if (datos != nullptr) {
+
+        if (pool != nullptr) {
+            pool->devolver(*this);
+        }
+        else {
+            liberarMemoria(datos, capacidad, mapeado);
+        }
+
+    }
+
+    datos = nullptr;
+    tam = 0;
+    capacidad = 0;
+    pool = nullptr;
+
+}
+
+
+/* ************************************************** Pool *********************************************************** */
+
+PoolBuffers::PoolBuffers(size_t maxBytesLibres)
+    : maxBytesLibres(maxBytesLibres){
+
+}
+
+PoolBuffers::~PoolBuffers(){
+
+    vaciar();
+
+}
+
+BufferAlineado PoolBuffers::obtener(size_t bytes){
+    /*
+ * @brief Entrega un buffer de al menos 'bytes' bytes alineado a 64, sin inicializar.
+ *
+ * Se reutiliza el buffer libre más chico que alcance, siempre que no pase del doble de lo pedido (así una
+ * máscara pequeña no se queda con el buffer de una imagen completa). El pool debe vivir más que sus buffers.
+ */
+
+    BufferAlineado buffer;
+    buffer.tam = bytes;
+    buffer.pool = this;
+
+    if (bytes == 0) {
+        return buffer;
+    }
+
+    bool conPaginasGrandes;
+
+    {
+        lock_guard<mutex> guardia(candado);
+
+        size_t elegido = libres.size();
+
+        for (size_t i = 0; i < libres.size(); i++) {
+            if (libres[i].capacidad >= bytes && libres[i].capacidad / 2 <= bytes && (elegido == libres.size() || libres[i].capacidad < libres[elegido].capacidad)) {
+                elegido = i;
+            }
+        }
+
+        if (elegido < libres.size()) {
+
+            buffer.datos = libres[elegido].datos;
+            buffer.capacidad = libres[elegido].capacidad;
+            buffer.mapeado = libres[elegido].mapeado;
+
+            bytesLibres -= buffer.capacidad;
+            libres[elegido] = libres.back();
+            libres.pop_back();
+            cantidadReutilizados++;
+
+            return buffer;
+
+        }
+
+        cantidadReservados++;
+        conPaginasGrandes = grandes;
+    }
+
+    // Las páginas grandes solo valen la pena para buffers de al menos una página
+    buffer.capacidad = bytes;
+    buffer.datos = reservarMemoria(buffer.capacidad, conPaginasGrandes && bytes >= BYTES_PAGINA_GRANDE, buffer.mapeado);
+
+    return buffer;
+
+}
+
+void PoolBuffers::devolver(BufferAlineado& buffer){
+
+    {
+        lock_guard<mutex> guardia(candado);
+
+        if (bytesLibres + buffer.capacidad <= maxBytesLibres) {
+
+            libres.push_back({buffer.datos, buffer.capacidad, buffer.mapeado});
+            bytesLibres += buffer.capacidad;
+
+            return;
+
+        }
+    }
+
+    liberarMemoria(buffer.datos, buffer.capacidad, buffer.mapeado);
+
+}
+
+void PoolBuffers::usarPaginasGrandes(bool activar){
+
+    lock_guard<mutex> guardia(candado);
+    grandes = activar;
+
+}
+
+bool PoolBuffers::paginasGrandes() const{
+
+    lock_guard<mutex> guardia(candado);
+    return grandes;
+
+}
+
+void PoolBuffers::vaciar(){
+
+    vector<Libre> liberados;
+
+    {
+        lock_guard<mutex> guardia(candado);
+        liberados.swap(libres);
+        bytesLibres = 0;
+    }
+
+    for (const Libre& libre : liberados) {
+        liberarMemoria(libre.datos, libre.capacidad, libre.mapeado);
+    }
+
+}
+
+size_t PoolBuffers::reservados() const{
+
+    lock_guard<mutex> guardia(candado);
+    return cantidadReservados;
+
+}
+
+size_t PoolBuffers::reutilizados() const{
+
+    lock_guard<mutex> guardia(candado);
+    return cantidadReutilizados;
+
+}
+
+PoolBuffers& poolBuffers(){
+
+    // No se destruye nunca: las imágenes que se liberan durante la destrucción de otros objetos estáticos
+    // todavía pueden volver a él
+    static PoolBuffers* pool = new PoolBuffers();
+
+    return *pool;
+
+}
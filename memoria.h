@@ -0,0 +1,95 @@
+#ifndef MEMORIA_H
+#define MEMORIA_H
+
+/* Buffers de imágenes completas reutilizables
+ *
+ * En los casos grandes cada imagen (I_D decodificada, I_M, M, los BMP codificados para exportar) ocupa cientos de
+ * MB, y reservarla de nuevo en cada caso o en cada exportación cuesta fallos de página y llamadas al sistema.
+ * PoolBuffers conserva los buffers liberados y los entrega de nuevo al siguiente pedido de un tamaño parecido.
+ *
+ * Todos los buffers empiezan en un límite de 64 bytes (una línea de caché, el ancho de AVX-512). Con páginas
+ * grandes (--huge-pages) se reservan en páginas de 2 MiB si el sistema las tiene disponibles y, si no, se vuelve
+ * a la reserva normal sin avisar.
+ */
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+const size_t ALINEACION_BUFFER = 64;
+const size_t BYTES_PAGINA_GRANDE = (size_t)2 << 20;
+
+class PoolBuffers;
+
+// Buffer alineado con dueño único; al destruirse vuelve al pool del que salió (o se libera si no tiene pool)
+class BufferAlineado {
+public:
+    BufferAlineado() = default;
+    ~BufferAlineado();
+
+    BufferAlineado(BufferAlineado&& otro) noexcept;
+    BufferAlineado& operator=(BufferAlineado&& otro) noexcept;
+
+    BufferAlineado(const BufferAlineado&) = delete;
+    BufferAlineado& operator=(const BufferAlineado&) = delete;
+
+    unsigned char* data() { return datos; }
+    const unsigned char* data() const { return datos; }
+    size_t size() const { return tam; }
+    bool empty() const { return tam == 0; }
+
+    void liberar();
+
+private:
+    friend class PoolBuffers;
+
+    unsigned char* datos = nullptr;
+    size_t tam = 0;                     // Bytes pedidos
+    size_t capacidad = 0;               // Bytes reservados (múltiplo de la alineación o de la página grande)
+    bool mapeado = false;               // Reservado con mmap / VirtualAlloc en lugar del montículo
+    PoolBuffers* pool = nullptr;
+};
+
+class PoolBuffers {
+public:
+    // maxBytesLibres: bytes de buffers liberados que se conservan; lo que pase de ahí se devuelve al sistema
+    explicit PoolBuffers(size_t maxBytesLibres = (size_t)1 << 30);
+    ~PoolBuffers();
+
+    PoolBuffers(const PoolBuffers&) = delete;
+    PoolBuffers& operator=(const PoolBuffers&) = delete;
+
+    BufferAlineado obtener(size_t bytes);
+
+    void usarPaginasGrandes(bool activar);
+    bool paginasGrandes() const;
+    void vaciar();                      // Devuelve al sistema los buffers libres
+
+    size_t reservados() const;          // Buffers pedidos al sistema
+    size_t reutilizados() const;        // Pedidos atendidos con un buffer libre
+
+private:
+    friend class BufferAlineado;
+
+    struct Libre {
+        unsigned char* datos;
+        size_t capacidad;
+        bool mapeado;
+    };
+
+    void devolver(BufferAlineado& buffer);
+
+    size_t maxBytesLibres;
+    bool grandes = false;
+
+    mutable std::mutex candado;
+    std::vector<Libre> libres;
+    size_t bytesLibres = 0;
+    size_t cantidadReservados = 0;
+    size_t cantidadReutilizados = 0;
+};
+
+// Pool de todo el proceso para las imágenes (ImagenRgb, ImagenCodificada)
+PoolBuffers& poolBuffers();
+
+#endif // MEMORIA_H
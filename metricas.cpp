@@ -0,0 +1,436 @@
+#include "metricas.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <new>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+
+/* ************************************************** Reservas de memoria *********************************************************** */
+
+// Llamadas a operator new en todo el proceso (new[] y las versiones nothrow pasan por aquí)
+static atomic<unsigned long long> contadorReservas(0);
+
+void* operator new(size_t bytes){
+
+    contadorReservas.fetch_add(1, memory_order_relaxed);
+
+    if (bytes == 0) {
+        bytes = 1;
+    }
+
+    for (;;) {
+
+        void* memoria = malloc(bytes);
+
+        if (memoria != nullptr) {
+            return memoria;
+        }
+
+        new_handler manejador = get_new_handler();
+
+        if (manejador == nullptr) {
+            throw bad_alloc();
+        }
+
+        manejador();
+
+    }
+
+}
+
+// GCC avisa de un free sobre memoria de operator new cuando inlinea este reemplazo en este mismo archivo
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void* memoria) noexcept{
+
+    free(memoria);
+
+}
+
+void operator delete(void* memoria, size_t) noexcept{
+
+    free(memoria);
+
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+unsigned long long reservasMemoria(){
+
+    return contadorReservas.load(memory_order_relaxed);
+
+}
+
+size_t picoMemoriaResidente(){
+
+#ifdef _WIN32
+
+    PROCESS_MEMORY_COUNTERS contadores;
+
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &contadores, sizeof(contadores))) {
+        return 0;
+    }
+
+    return contadores.PeakWorkingSetSize;
+
+#else
+
+    struct rusage uso;
+
+    if (getrusage(RUSAGE_SELF, &uso) != 0) {
+        return 0;
+    }
+
+    // Linux informa kilobytes y macOS bytes
+#ifdef __APPLE__
+    return (size_t)uso.ru_maxrss;
+#else
+    return (size_t)uso.ru_maxrss * 1024;
+#endif
+
+#endif
+
+}
+
+size_t tamanoArchivo(const string& ruta){
+
+    error_code error;
+    uintmax_t bytes = filesystem::file_size(ruta, error);
+
+    return error ? 0 : (size_t)bytes;
+
+}
+
+
+/* ************************************************** Registro *********************************************************** */
+
+const char* nombreFase(FaseMetrica fase){
+
+    switch (fase) {
+    case FASE_CARGA_IMAGENES:           return "carga_imagenes";
+    case FASE_CARGA_ENMASCARAMIENTO:    return "carga_enmascaramiento";
+    case FASE_IDENTIFICACION:           return "identificacion";
+    case FASE_BUSQUEDA:                 return "busqueda";
+    case FASE_APLICACION:               return "aplicacion";
+    case FASE_EXPORTACION:              return "exportacion";
+    default:                            return "";
+    }
+
+}
+
+MetricasEtapa& MetricasCaso::etapa(int e){
+
+    if ((int)etapas.size() <= e) {
+
+        size_t anterior = etapas.size();
+        etapas.resize(e + 1);
+
+        for (size_t i = anterior; i < etapas.size(); i++) {
+            etapas[i].etapa = (int)i;
+        }
+
+    }
+
+    return etapas[e];
+
+}
+
+void RegistroMetricas::agregar(const MetricasCaso& caso){
+
+    lock_guard<mutex> guardia(candado);
+
+    // El caso registrado otra vez pasa al final, como el más reciente
+    for (size_t i = 0; i < casos.size(); i++) {
+        if (casos[i].nombre == caso.nombre) {
+            casos.erase(casos.begin() + i);
+            break;
+        }
+    }
+
+    casos.push_back(caso);
+
+    if (maxCasos > 0 && casos.size() > maxCasos) {
+        casos.erase(casos.begin(), casos.end() - maxCasos);
+    }
+
+}
+
+// Comillas, barras invertidas y saltos de línea escapados, igual en JSON y en las etiquetas de Prometheus
+static string escapar(const string& texto){
+
+    string resultado;
+
+    for (char c : texto) {
+
+        if (c == '"' || c == '\\') {
+            resultado += '\\';
+            resultado += c;
+        }
+        else if (c == '\n') {
+            resultado += "\\n";
+        }
+        else {
+            resultado += c;
+        }
+
+    }
+
+    return resultado;
+
+}
+
+// Totales del caso: lo medido fuera de las etapas más lo de cada etapa
+static void totalesCaso(const MetricasCaso& caso, double segundos[NUM_FASES], size_t& leidos, size_t& escritos){
+
+    leidos = caso.bytesLeidos;
+    escritos = caso.bytesEscritos;
+
+    for (int f = 0; f < NUM_FASES; f++) {
+        segundos[f] = caso.segundos[f];
+    }
+
+    for (const MetricasEtapa& etapa : caso.etapas) {
+
+        leidos += etapa.bytesLeidos;
+        escritos += etapa.bytesEscritos;
+
+        for (int f = 0; f < NUM_FASES; f++) {
+            segundos[f] += etapa.segundos[f];
+        }
+
+    }
+
+}
+
+static void escribirFases(ostream& salida, const double segundos[NUM_FASES]){
+
+    salida<<"{";
+
+    for (int f = 0; f < NUM_FASES; f++) {
+        salida<<(f > 0 ? ", " : "")<<"\""<<nombreFase((FaseMetrica)f)<<"\": "<<segundos[f];
+    }
+
+    salida<<"}";
+
+}
+
+string RegistroMetricas::json() const{
+    /*
+ * @brief Informe de todos los casos en JSON; los tiempos en segundos y las etapas numeradas desde 1, como en el informe de consola.
+ */
+
+    lock_guard<mutex> guardia(candado);
+    ostringstream json;
+    json.precision(9);
+
+    json<<"{"<<endl<<"  \"casos\": ["<<endl;
+
+    for (size_t i = 0; i < casos.size(); i++) {
+
+        const MetricasCaso& caso = casos[i];
+        double segundos[NUM_FASES];
+        size_t leidos;
+        size_t escritos;
+
+        totalesCaso(caso, segundos, leidos, escritos);
+
+        json<<"    {"<<endl;
+        json<<"      \"nombre\": \""<<escapar(caso.nombre)<<"\","<<endl;
+        json<<"      \"reconstruido\": "<<(caso.reconstruido ? "true" : "false")<<","<<endl;
+        json<<"      \"segundos\": "<<caso.segundosTotales<<","<<endl;
+        json<<"      \"fases\": ";
+        escribirFases(json, segundos);
+        json<<","<<endl;
+        json<<"      \"bytes_leidos\": "<<leidos<<","<<endl;
+        json<<"      \"bytes_escritos\": "<<escritos<<","<<endl;
+        json<<"      \"reservas\": "<<caso.reservas<<","<<endl;
+        json<<"      \"pico_memoria_bytes\": "<<caso.picoMemoria<<","<<endl;
+        json<<"      \"etapas\": ["<<endl;
+
+        for (size_t e = 0; e < caso.etapas.size(); e++) {
+
+            const MetricasEtapa& etapa = caso.etapas[e];
+
+            json<<"        {\"etapa\": "<<etapa.etapa + 1<<", \"fases\": ";
+            escribirFases(json, etapa.segundos);
+            json<<", \"candidatos\": "<<etapa.candidatos<<", \"bytes_revisados\": "<<etapa.bytesRevisados<<", \"nodos_busqueda\": "<<etapa.nodosBusqueda;
+            json<<", \"bytes_leidos\": "<<etapa.bytesLeidos<<", \"bytes_escritos\": "<<etapa.bytesEscritos;
+            json<<", \"reservas\": "<<etapa.reservas<<", \"pico_memoria_bytes\": "<<etapa.picoMemoria<<"}"<<(e + 1 < caso.etapas.size() ? "," : "")<<endl;
+
+        }
+
+        json<<"      ]"<<endl;
+        json<<"    }"<<(i + 1 < casos.size() ? "," : "")<<endl;
+
+    }
+
+    json<<"  ]"<<endl<<"}"<<endl;
+
+    return json.str();
+
+}
+
+string RegistroMetricas::prometheus() const{
+    /*
+ * @brief Informe en el formato de texto de Prometheus, para el textfile collector de node_exporter.
+ *
+ * Todas las métricas son gauges con la etiqueta caso (y etapa y fase cuando corresponde).
+ */
+
+    lock_guard<mutex> guardia(candado);
+    ostringstream texto;
+    texto.precision(9);
+
+    auto metrica = [&](const char* nombre, const char* ayuda, const function<void()>& muestras){
+
+        texto<<"# HELP "<<nombre<<" "<<ayuda<<endl;
+        texto<<"# TYPE "<<nombre<<" gauge"<<endl;
+        muestras();
+
+    };
+
+    auto etiquetaCaso = [](const MetricasCaso& caso){ return "caso=\"" + escapar(caso.nombre) + "\""; };
+
+    auto porCaso = [&](const char* nombre, const char* ayuda, const function<double(const MetricasCaso&)>& valor){
+
+        metrica(nombre, ayuda, [&]{
+            for (const MetricasCaso& caso : casos) {
+                texto<<nombre<<"{"<<etiquetaCaso(caso)<<"} "<<valor(caso)<<endl;
+            }
+        });
+
+    };
+
+    auto porEtapa = [&](const char* nombre, const char* ayuda, const function<double(const MetricasEtapa&)>& valor){
+
+        metrica(nombre, ayuda, [&]{
+            for (const MetricasCaso& caso : casos) {
+                for (const MetricasEtapa& etapa : caso.etapas) {
+                    texto<<nombre<<"{"<<etiquetaCaso(caso)<<",etapa=\""<<etapa.etapa + 1<<"\"} "<<valor(etapa)<<endl;
+                }
+            }
+        });
+
+    };
+
+    porCaso("desafio1_caso_segundos", "Tiempo total de la reconstruccion del caso.", [](const MetricasCaso& c){ return c.segundosTotales; });
+    porCaso("desafio1_caso_reconstruido", "1 si el caso se reconstruyo por completo.", [](const MetricasCaso& c){ return c.reconstruido ? 1.0 : 0.0; });
+
+    metrica("desafio1_caso_fase_segundos", "Tiempo del caso por fase, sumando todas las etapas.", [&]{
+        for (const MetricasCaso& caso : casos) {
+
+            double segundos[NUM_FASES];
+            size_t leidos;
+            size_t escritos;
+
+            totalesCaso(caso, segundos, leidos, escritos);
+
+            for (int f = 0; f < NUM_FASES; f++) {
+                texto<<"desafio1_caso_fase_segundos{"<<etiquetaCaso(caso)<<",fase=\""<<nombreFase((FaseMetrica)f)<<"\"} "<<segundos[f]<<endl;
+            }
+
+        }
+    });
+
+    porCaso("desafio1_caso_bytes_leidos", "Bytes leidos de imagenes y archivos de enmascaramiento.", [](const MetricasCaso& c){
+        double s[NUM_FASES]; size_t leidos, escritos; totalesCaso(c, s, leidos, escritos); return (double)leidos;
+    });
+    porCaso("desafio1_caso_bytes_escritos", "Bytes escritos en imagenes exportadas y Validacion.txt.", [](const MetricasCaso& c){
+        double s[NUM_FASES]; size_t leidos, escritos; totalesCaso(c, s, leidos, escritos); return (double)escritos;
+    });
+    porCaso("desafio1_caso_reservas", "Llamadas a operator new del proceso durante el caso.", [](const MetricasCaso& c){ return (double)c.reservas; });
+    porCaso("desafio1_memoria_pico_bytes", "Pico de memoria residente del proceso al terminar el caso.", [](const MetricasCaso& c){ return (double)c.picoMemoria; });
+
+    metrica("desafio1_etapa_fase_segundos", "Tiempo de cada etapa por fase.", [&]{
+        for (const MetricasCaso& caso : casos) {
+            for (const MetricasEtapa& etapa : caso.etapas) {
+                for (int f = 0; f < NUM_FASES; f++) {
+                    texto<<"desafio1_etapa_fase_segundos{"<<etiquetaCaso(caso)<<",etapa=\""<<etapa.etapa + 1<<"\",fase=\""<<nombreFase((FaseMetrica)f)<<"\"} "<<etapa.segundos[f]<<endl;
+                }
+            }
+        }
+    });
+
+    porEtapa("desafio1_etapa_candidatos", "Candidatos probados contra la ventana de enmascaramiento.", [](const MetricasEtapa& e){ return (double)e.candidatos; });
+    porEtapa("desafio1_etapa_bytes_revisados", "Bytes de la ventana recorridos al identificar la operacion.", [](const MetricasEtapa& e){ return (double)e.bytesRevisados; });
+    porEtapa("desafio1_etapa_nodos_busqueda", "Secuencias evaluadas por la busqueda con retroceso.", [](const MetricasEtapa& e){ return (double)e.nodosBusqueda; });
+    porEtapa("desafio1_etapa_bytes_leidos", "Bytes del archivo de enmascaramiento de la etapa.", [](const MetricasEtapa& e){ return (double)e.bytesLeidos; });
+    porEtapa("desafio1_etapa_bytes_escritos", "Bytes escritos por la etapa (--dump-stages, --dump-validation).", [](const MetricasEtapa& e){ return (double)e.bytesEscritos; });
+    porEtapa("desafio1_etapa_reservas", "Llamadas a operator new del proceso durante la etapa.", [](const MetricasEtapa& e){ return (double)e.reservas; });
+    porEtapa("desafio1_etapa_memoria_pico_bytes", "Pico de memoria residente del proceso al terminar la etapa.", [](const MetricasEtapa& e){ return (double)e.picoMemoria; });
+
+    return texto.str();
+
+}
+
+bool RegistroMetricas::escribir(const string& rutaJson, const string& rutaPrometheus, string& error) const{
+    /*
+ * @brief Escribe los informes pedidos (una ruta vacía se omite).
+ *
+ * El archivo de Prometheus se escribe con otro nombre y se renombra al final, para que node_exporter nunca lea
+ * un archivo a medio escribir.
+ */
+
+    auto guardar = [&](const string& ruta, const string& contenido){
+
+        FILE* archivo = fopen(ruta.c_str(), "wb");
+
+        if (archivo == nullptr) {
+            error = "No se pudo escribir " + ruta;
+            return false;
+        }
+
+        bool escrito = fwrite(contenido.data(), 1, contenido.size(), archivo) == contenido.size();
+        escrito = (fclose(archivo) == 0) && escrito;
+
+        if (!escrito) {
+            error = "No se pudo escribir " + ruta;
+        }
+
+        return escrito;
+
+    };
+
+    if (!rutaJson.empty() && !guardar(rutaJson, json())) {
+        return false;
+    }
+
+    if (!rutaPrometheus.empty()) {
+
+        string temporal = rutaPrometheus + ".tmp";
+        error_code errorRenombrar;
+
+        if (!guardar(temporal, prometheus())) {
+            return false;
+        }
+
+        filesystem::rename(temporal, rutaPrometheus, errorRenombrar);
+
+        if (errorRenombrar) {
+            error = "No se pudo escribir " + rutaPrometheus + ": " + errorRenombrar.message();
+            return false;
+        }
+
+    }
+
+    return true;
+
+}
@@ -0,0 +1,84 @@
+#ifndef METRICAS_H
+#define METRICAS_H
+
+/* Mediciones de la reconstrucción (--metrics-json, --metrics-prom)
+ *
+ * Para cada caso se registra el tiempo de cada fase (carga de imágenes, carga de enmascaramientos,
+ * identificación, búsqueda con retroceso, aplicación de las operaciones y exportación), por etapa y en total,
+ * los candidatos probados, los bytes leídos y escritos, las reservas de memoria y el pico de memoria residente.
+ * El informe se escribe en JSON o como archivo de texto para el textfile collector de node_exporter (Prometheus).
+ *
+ * Las reservas de memoria se cuentan reemplazando el operator new global, y como el pico de memoria, son del
+ * proceso completo: con --batch en varios hilos incluyen lo de los casos que corren a la vez.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum FaseMetrica { FASE_CARGA_IMAGENES, FASE_CARGA_ENMASCARAMIENTO, FASE_IDENTIFICACION, FASE_BUSQUEDA, FASE_APLICACION, FASE_EXPORTACION, NUM_FASES };
+
+struct MetricasEtapa {
+    int etapa = 0;                          // 0 = primera etapa del proceso
+    double segundos[NUM_FASES] = {};
+    long long candidatos = 0;               // Candidatos probados contra la ventana
+    long long bytesRevisados = 0;           // Bytes de la ventana recorridos al identificar
+    long long nodosBusqueda = 0;            // Secuencias evaluadas por la búsqueda con retroceso
+    size_t bytesLeidos = 0;                 // Archivo de enmascaramiento
+    size_t bytesEscritos = 0;               // Imagen de --dump-stages y Validacion.txt
+    unsigned long long reservas = 0;        // Llamadas a operator new desde la etapa anterior
+    size_t picoMemoria = 0;                 // Pico de memoria residente del proceso al terminar la etapa
+};
+
+struct MetricasCaso {
+    std::string nombre;
+    bool reconstruido = false;
+    double segundosTotales = 0;
+    double segundos[NUM_FASES] = {};        // Fases fuera de las etapas (carga de imágenes, imagen final)
+    size_t bytesLeidos = 0;
+    size_t bytesEscritos = 0;
+    unsigned long long reservas = 0;        // Llamadas a operator new durante el caso
+    size_t picoMemoria = 0;                 // Pico de memoria residente del proceso al terminar el caso
+    std::vector<MetricasEtapa> etapas;      // Indexadas por etapa
+
+    MetricasEtapa& etapa(int e);
+};
+
+// Mide el tiempo desde su creación
+class Cronometro {
+public:
+    Cronometro() : inicio(std::chrono::steady_clock::now()) {}
+
+    double segundos() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count(); }
+
+private:
+    std::chrono::steady_clock::time_point inicio;
+};
+
+// Casos medidos durante la ejecución; se pueden agregar desde varios hilos. Un caso con el nombre de otro ya
+// registrado lo reemplaza (--daemon registra cada pedido y el archivo de Prometheus conserva el último de cada caso).
+// Con maxCasos > 0 se conservan solo los maxCasos casos registrados más recientemente
+class RegistroMetricas {
+public:
+    explicit RegistroMetricas(size_t maxCasos = 0) : maxCasos(maxCasos) {}
+
+    void agregar(const MetricasCaso& caso);
+
+    std::string json() const;
+    std::string prometheus() const;
+    bool escribir(const std::string& rutaJson, const std::string& rutaPrometheus, std::string& error) const;
+
+private:
+    mutable std::mutex candado;
+    size_t maxCasos;
+    std::vector<MetricasCaso> casos;            // Del registrado hace más tiempo al más reciente
+};
+
+const char* nombreFase(FaseMetrica fase);
+unsigned long long reservasMemoria();
+size_t picoMemoriaResidente();
+size_t tamanoArchivo(const std::string& ruta);
+
+#endif // METRICAS_H
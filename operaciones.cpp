@@ -0,0 +1,670 @@
+#include "operaciones.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OPERACIONES_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+
+/* ************************************************** Operaciones escalares *********************************************************** */
+
+unsigned char desplazamientoIzq(unsigned char Id, int n){
+
+    return Id << n;
+
+}
+
+unsigned char desplazamientoDer(unsigned char Id, int n){
+
+    return Id >> n;
+
+}
+
+unsigned char rotacionIzq(unsigned char Id, int n){
+
+    return (Id << n) | (Id >> (8 - n));
+
+}
+
+unsigned char rotacionDer(unsigned char Id, int n){
+
+    return (Id >> n) | (Id << (8 - n));
+
+}
+
+unsigned char operacionXor(unsigned char Id, unsigned char IM){
+
+    return Id ^ IM;
+
+}
+
+
+/* ************************************************** Operaciones candidatas *********************************************************** */
+
+void generarCandidatos(Operacion* candidatos){
+
+    int c=0;
+
+    candidatos[c++] = {OP_XOR, 0};
+
+    for (int j=1;j<9;j++) candidatos[c++] = {OP_ROTACION_IZQ, j};
+    for (int j=1;j<9;j++) candidatos[c++] = {OP_ROTACION_DER, j};
+    for (int j=1;j<9;j++) candidatos[c++] = {OP_DESPLAZAMIENTO_IZQ, j};
+    for (int j=1;j<9;j++) candidatos[c++] = {OP_DESPLAZAMIENTO_DER, j};
+
+}
+
+void aplicarOperacion(Operacion op, const unsigned char* origen, unsigned char* destino, const unsigned char* IM, size_t size){
+    /*
+ * @brief Aplica una operación a nivel de bits sobre un bloque de bytes.
+ *
+ * Puede trabajar fuera de lugar (origen != destino), por ejemplo sobre una ventana de prueba,
+ * o en el mismo lugar (origen == destino) sobre la imagen completa.
+ *
+ * @param op Operación a aplicar.
+ * @param origen Bytes de entrada.
+ * @param destino Bytes de salida (puede ser igual a origen).
+ * @param IM Bytes de la imagen I_M alineados con origen; solo se usan en la XOR.
+ * @param size Cantidad de bytes a procesar.
+ */
+
+    switch (op.tipo) {
+
+    case OP_XOR:
+        xorBuffer(origen, IM, destino, size);
+        break;
+
+    case OP_ROTACION_IZQ:
+        rotacionIzqBuffer(origen, destino, size, op.bits);
+        break;
+
+    case OP_ROTACION_DER:
+        rotacionDerBuffer(origen, destino, size, op.bits);
+        break;
+
+    case OP_DESPLAZAMIENTO_IZQ:
+        desplazamientoIzqBuffer(origen, destino, size, op.bits);
+        break;
+
+    case OP_DESPLAZAMIENTO_DER:
+        desplazamientoDerBuffer(origen, destino, size, op.bits);
+        break;
+
+    }
+
+}
+
+string nombreOperacion(Operacion op){
+
+    // El nombre describe la transformación original que la operación revierte
+    switch (op.tipo) {
+    case OP_XOR:                return "Operacion XOR con la imagen I_M";
+    case OP_ROTACION_IZQ:       return "Rotacion a la derecha de " + to_string(op.bits) + " bits";
+    case OP_ROTACION_DER:       return "Rotacion a la izquierda de " + to_string(op.bits) + " bits";
+    case OP_DESPLAZAMIENTO_IZQ: return "Desplazamiento a la derecha de " + to_string(op.bits) + " bits";
+    case OP_DESPLAZAMIENTO_DER: return "Desplazamiento a la izquierda de " + to_string(op.bits) + " bits";
+    }
+
+    return "";
+
+}
+
+bool ventanaEnImagen(long long semilla, size_t tamVentana, size_t totalBytes){
+
+    // Se compara con totalBytes - tamVentana en lugar de sumar: con semillas grandes la suma puede desbordar
+    return semilla >= 0 && tamVentana <= totalBytes && (unsigned long long)semilla <= totalBytes - tamVentana;
+
+}
+
+
+/* ************************************************** Núcleos sobre buffers *********************************************************** */
+
+/* Todas las rotaciones y desplazamientos de un byte se escriben como
+ *
+ *      destino = ((origen << izq) & 0xFF) | (origen >> der)     con 0 ≤ izq, der ≤ 8
+ *
+ * desplazamientoIzq(n) = (n, 8), desplazamientoDer(n) = (8, n), rotacionIzq(n) = (n, 8 - n) y rotacionDer(n) = (8 - n, n).
+ * Las versiones vectorizadas desplazan palabras de 16 bits y luego eliminan con una máscara los bits que
+ * pasaron de un byte al vecino.
+ *
+ * (izq, der) son parámetros de plantilla: hay un bucle por par y por nivel, con desplazamientos inmediatos y sin
+ * la mitad que siempre da cero cuando la cuenta es 8. tablaNucleos<nivel>[tipo][n] los reúne en tiempo de
+ * compilación; rotacionIzq(n) y rotacionDer(8 - n) comparten el mismo bucle.
+ *
+ * Las tablas de 256 entradas que solo mueven o eliminan bits cumplen tabla[x] = tabla[x & 0x0F] | tabla[x & 0xF0],
+ * así que se pueden aplicar con dos búsquedas de 16 entradas (pshufb) por byte.
+ */
+
+using NucleoFijo = void (*)(const unsigned char* origen, unsigned char* destino, size_t size);
+using TablaNucleos = array<array<NucleoFijo, 9>, 5>;         // [tipo][bits]; la fila de la XOR queda vacía
+
+struct KernelsBits {
+    NivelSimd nivel;
+    void (*xorBuf)(const unsigned char* origen, const unsigned char* IM, unsigned char* destino, size_t size);
+    const TablaNucleos* nucleos;
+    void (*tablaNibbles)(const unsigned char* origen, unsigned char* destino, size_t size, const unsigned char* bajo, const unsigned char* alto);
+};
+
+static void xorEscalar(const unsigned char* origen, const unsigned char* IM, unsigned char* destino, size_t size){
+
+    for (size_t i = 0; i < size; i++) destino[i] = operacionXor(origen[i], IM[i]);
+
+}
+
+template <int Izq, int Der>
+static void desplazamientosEscalar(const unsigned char* origen, unsigned char* destino, size_t size){
+
+    for (size_t i = 0; i < size; i++) destino[i] = desplazarFijo<Izq, Der>(origen[i]);
+
+}
+
+static void tablaNibblesEscalar(const unsigned char* origen, unsigned char* destino, size_t size, const unsigned char* bajo, const unsigned char* alto){
+
+    for (size_t i = 0; i < size; i++) destino[i] = bajo[origen[i] & 0x0F] | alto[origen[i] >> 4];
+
+}
+
+#ifdef OPERACIONES_X86
+
+__attribute__((target("sse2")))
+static void xorSse2(const unsigned char* origen, const unsigned char* IM, unsigned char* destino, size_t size){
+
+    size_t i = 0;
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(origen + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(IM + i));
+        _mm_storeu_si128((__m128i*)(destino + i), _mm_xor_si128(a, b));
+    }
+
+    xorEscalar(origen + i, IM + i, destino + i, size - i);
+
+}
+
+template <int Izq, int Der>
+__attribute__((target("sse2")))
+static void desplazamientosSse2(const unsigned char* origen, unsigned char* destino, size_t size){
+
+    const __m128i mascaraIzq = _mm_set1_epi8((char)((0xFF << Izq) & 0xFF));
+    const __m128i mascaraDer = _mm_set1_epi8((char)(0xFF >> Der));
+
+    size_t i = 0;
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(origen + i));
+        __m128i r = _mm_setzero_si128();
+        if constexpr (Izq < 8) r = _mm_and_si128(_mm_slli_epi16(v, Izq), mascaraIzq);
+        if constexpr (Der < 8) r = _mm_or_si128(r, _mm_and_si128(_mm_srli_epi16(v, Der), mascaraDer));
+        _mm_storeu_si128((__m128i*)(destino + i), r);
+    }
+
+    desplazamientosEscalar<Izq, Der>(origen + i, destino + i, size - i);
+
+}
+
+__attribute__((target("avx2")))
+static void xorAvx2(const unsigned char* origen, const unsigned char* IM, unsigned char* destino, size_t size){
+
+    size_t i = 0;
+
+    for (; i + 32 <= size; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(origen + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(IM + i));
+        _mm256_storeu_si256((__m256i*)(destino + i), _mm256_xor_si256(a, b));
+    }
+
+    xorEscalar(origen + i, IM + i, destino + i, size - i);
+
+}
+
+template <int Izq, int Der>
+__attribute__((target("avx2")))
+static void desplazamientosAvx2(const unsigned char* origen, unsigned char* destino, size_t size){
+
+    const __m256i mascaraIzq = _mm256_set1_epi8((char)((0xFF << Izq) & 0xFF));
+    const __m256i mascaraDer = _mm256_set1_epi8((char)(0xFF >> Der));
+
+    size_t i = 0;
+
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(origen + i));
+        __m256i r = _mm256_setzero_si256();
+        if constexpr (Izq < 8) r = _mm256_and_si256(_mm256_slli_epi16(v, Izq), mascaraIzq);
+        if constexpr (Der < 8) r = _mm256_or_si256(r, _mm256_and_si256(_mm256_srli_epi16(v, Der), mascaraDer));
+        _mm256_storeu_si256((__m256i*)(destino + i), r);
+    }
+
+    desplazamientosEscalar<Izq, Der>(origen + i, destino + i, size - i);
+
+}
+
+__attribute__((target("avx2")))
+static void tablaNibblesAvx2(const unsigned char* origen, unsigned char* destino, size_t size, const unsigned char* bajo, const unsigned char* alto){
+
+    __m256i tablaBajo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)bajo));
+    __m256i tablaAlto = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)alto));
+    __m256i nibble = _mm256_set1_epi8(0x0F);
+
+    size_t i = 0;
+
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(origen + i));
+        __m256i a = _mm256_shuffle_epi8(tablaBajo, _mm256_and_si256(v, nibble));
+        __m256i b = _mm256_shuffle_epi8(tablaAlto, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+        _mm256_storeu_si256((__m256i*)(destino + i), _mm256_or_si256(a, b));
+    }
+
+    tablaNibblesEscalar(origen + i, destino + i, size - i, bajo, alto);
+
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void xorAvx512(const unsigned char* origen, const unsigned char* IM, unsigned char* destino, size_t size){
+
+    size_t i = 0;
+
+    for (; i + 64 <= size; i += 64) {
+        __m512i a = _mm512_loadu_si512((const void*)(origen + i));
+        __m512i b = _mm512_loadu_si512((const void*)(IM + i));
+        _mm512_storeu_si512((void*)(destino + i), _mm512_xor_si512(a, b));
+    }
+
+    xorEscalar(origen + i, IM + i, destino + i, size - i);
+
+}
+
+template <int Izq, int Der>
+__attribute__((target("avx512f,avx512bw")))
+static void desplazamientosAvx512(const unsigned char* origen, unsigned char* destino, size_t size){
+
+    const __m512i mascaraIzq = _mm512_set1_epi8((char)((0xFF << Izq) & 0xFF));
+    const __m512i mascaraDer = _mm512_set1_epi8((char)(0xFF >> Der));
+
+    size_t i = 0;
+
+    for (; i + 64 <= size; i += 64) {
+        __m512i v = _mm512_loadu_si512((const void*)(origen + i));
+        __m512i r = _mm512_setzero_si512();
+        if constexpr (Izq < 8) r = _mm512_and_si512(_mm512_slli_epi16(v, Izq), mascaraIzq);
+        if constexpr (Der < 8) r = _mm512_or_si512(r, _mm512_and_si512(_mm512_srli_epi16(v, Der), mascaraDer));
+        _mm512_storeu_si512((void*)(destino + i), r);
+    }
+
+    desplazamientosEscalar<Izq, Der>(origen + i, destino + i, size - i);
+
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void tablaNibblesAvx512(const unsigned char* origen, unsigned char* destino, size_t size, const unsigned char* bajo, const unsigned char* alto){
+
+    // pshufb busca dentro de cada carril de 128 bits, así que la tabla se repite en los cuatro carriles
+    unsigned char bajoRepetido[64];
+    unsigned char altoRepetido[64];
+
+    for (int x = 0; x < 64; x++) {
+        bajoRepetido[x] = bajo[x & 0x0F];
+        altoRepetido[x] = alto[x & 0x0F];
+    }
+
+    __m512i tablaBajo = _mm512_loadu_si512((const void*)bajoRepetido);
+    __m512i tablaAlto = _mm512_loadu_si512((const void*)altoRepetido);
+    __m512i nibble = _mm512_set1_epi8(0x0F);
+
+    size_t i = 0;
+
+    for (; i + 64 <= size; i += 64) {
+        __m512i v = _mm512_loadu_si512((const void*)(origen + i));
+        __m512i a = _mm512_shuffle_epi8(tablaBajo, _mm512_and_si512(v, nibble));
+        __m512i b = _mm512_shuffle_epi8(tablaAlto, _mm512_and_si512(_mm512_srli_epi16(v, 4), nibble));
+        _mm512_storeu_si512((void*)(destino + i), _mm512_or_si512(a, b));
+    }
+
+    tablaNibblesEscalar(origen + i, destino + i, size - i, bajo, alto);
+
+}
+
+#endif // OPERACIONES_X86
+
+template <NivelSimd Nivel, int Izq, int Der>
+static void desplazamientosFijos(const unsigned char* origen, unsigned char* destino, size_t size){
+
+#ifdef OPERACIONES_X86
+    if constexpr (Nivel == SIMD_AVX512) return desplazamientosAvx512<Izq, Der>(origen, destino, size);
+    if constexpr (Nivel == SIMD_AVX2) return desplazamientosAvx2<Izq, Der>(origen, destino, size);
+    if constexpr (Nivel == SIMD_SSE2) return desplazamientosSse2<Izq, Der>(origen, destino, size);
+#endif
+
+    desplazamientosEscalar<Izq, Der>(origen, destino, size);
+
+}
+
+template <NivelSimd Nivel, TipoOperacion Tipo, int... N>
+static constexpr array<NucleoFijo, 9> filaNucleos(integer_sequence<int, N...>){
+
+    // 0 bits no cambia nada: es el mismo bucle que la rotación de 8 bits, (izq, der) = (8, 0)
+    return {desplazamientosFijos<Nivel, 8, 0>, desplazamientosFijos<Nivel, Kernel<Tipo, N + 1>::izq, Kernel<Tipo, N + 1>::der>...};
+
+}
+
+template <NivelSimd Nivel>
+static constexpr TablaNucleos tablaNucleos = {{
+    {},
+    filaNucleos<Nivel, OP_ROTACION_IZQ>(make_integer_sequence<int, 8>()),
+    filaNucleos<Nivel, OP_ROTACION_DER>(make_integer_sequence<int, 8>()),
+    filaNucleos<Nivel, OP_DESPLAZAMIENTO_IZQ>(make_integer_sequence<int, 8>()),
+    filaNucleos<Nivel, OP_DESPLAZAMIENTO_DER>(make_integer_sequence<int, 8>()),
+}};
+
+template <TipoOperacion Tipo, int... N>
+static constexpr array<const unsigned char*, 9> filaTablas(integer_sequence<int, N...>){
+
+    return {Kernel<OP_ROTACION_IZQ, 8>::tabla.data(), Kernel<Tipo, N + 1>::tabla.data()...};
+
+}
+
+static constexpr array<array<const unsigned char*, 9>, 5> tablasKernel = {{
+    {},
+    filaTablas<OP_ROTACION_IZQ>(make_integer_sequence<int, 8>()),
+    filaTablas<OP_ROTACION_DER>(make_integer_sequence<int, 8>()),
+    filaTablas<OP_DESPLAZAMIENTO_IZQ>(make_integer_sequence<int, 8>()),
+    filaTablas<OP_DESPLAZAMIENTO_DER>(make_integer_sequence<int, 8>()),
+}};
+
+// Columna de las tablas para n bits: las rotaciones se toman módulo 8 y los desplazamientos de más de 8 bits
+// dan lo mismo que los de 8 (cero); 0 bits, o un desplazamiento negativo, no cambia nada
+static int columnaBits(TipoOperacion tipo, int n){
+
+    if (tipo == OP_ROTACION_IZQ || tipo == OP_ROTACION_DER) {
+        return ((n % 8) + 8) % 8;
+    }
+
+    return clamp(n, 0, 8);
+
+}
+
+const unsigned char* tablaOperacion(Operacion op){
+
+    if (op.tipo == OP_XOR) {
+        return nullptr;
+    }
+
+    return tablasKernel[op.tipo][columnaBits(op.tipo, op.bits)];
+
+}
+
+static KernelsBits kernelsPara(NivelSimd nivel){
+
+    KernelsBits k = {SIMD_ESCALAR, xorEscalar, &tablaNucleos<SIMD_ESCALAR>, tablaNibblesEscalar};
+
+#ifdef OPERACIONES_X86
+    switch (nivel) {
+    case SIMD_AVX512: k = {SIMD_AVX512, xorAvx512, &tablaNucleos<SIMD_AVX512>, tablaNibblesAvx512}; break;
+    case SIMD_AVX2:   k = {SIMD_AVX2, xorAvx2, &tablaNucleos<SIMD_AVX2>, tablaNibblesAvx2}; break;
+    case SIMD_SSE2:   k = {SIMD_SSE2, xorSse2, &tablaNucleos<SIMD_SSE2>, tablaNibblesEscalar}; break;
+    case SIMD_ESCALAR: break;
+    }
+#else
+    (void)nivel;
+#endif
+
+    return k;
+
+}
+
+// Se inicializa con el mejor nivel disponible la primera vez que se usa una operación sobre buffers
+static KernelsBits& kernelsActivos(){
+
+    static KernelsBits kernels = kernelsPara(detectarNivelSimd());
+    return kernels;
+
+}
+
+NivelSimd detectarNivelSimd(){
+    /*
+ * @brief Consulta CPUID (y XGETBV) para saber qué juego de instrucciones vectoriales se puede usar.
+ *
+ * Para AVX2 y AVX-512 no basta con que el procesador las soporte: el sistema operativo también debe
+ * guardar los registros extendidos en los cambios de contexto, lo que se revisa en XCR0.
+ *
+ * @return El nivel más alto disponible (AVX-512 requiere AVX512F y AVX512BW).
+ */
+
+#ifdef OPERACIONES_X86
+
+    unsigned int a=0, b=0, c=0, d=0;
+
+    if (!__get_cpuid(1, &a, &b, &c, &d)) {
+        return SIMD_ESCALAR;
+    }
+
+    bool sse2 = (d & bit_SSE2) != 0;
+    bool osxsave = (c & bit_OSXSAVE) != 0;
+    bool avx = (c & bit_AVX) != 0;
+
+    unsigned long long xcr0 = 0;
+
+    if (osxsave) {
+        unsigned int bajo=0, alto=0;
+        __asm__ volatile ("xgetbv" : "=a"(bajo), "=d"(alto) : "c"(0));
+        xcr0 = ((unsigned long long)alto << 32) | bajo;
+    }
+
+    // Estado XMM/YMM (bits 1 y 2) y estado de AVX-512 (bits 5, 6 y 7)
+    bool estadoAvx = osxsave && avx && (xcr0 & 0x06) == 0x06;
+    bool estadoAvx512 = estadoAvx && (xcr0 & 0xE0) == 0xE0;
+
+    bool avx2 = false;
+    bool avx512 = false;
+
+    if (__get_cpuid_max(0, nullptr) >= 7) {
+        __cpuid_count(7, 0, a, b, c, d);
+        avx2 = (b & bit_AVX2) != 0;
+        avx512 = (b & bit_AVX512F) != 0 && (b & bit_AVX512BW) != 0;
+    }
+
+    if (estadoAvx512 && avx512) return SIMD_AVX512;
+    if (estadoAvx && avx2) return SIMD_AVX2;
+    if (sse2) return SIMD_SSE2;
+
+#endif
+
+    return SIMD_ESCALAR;
+
+}
+
+NivelSimd nivelSimdActivo(){
+
+    return kernelsActivos().nivel;
+
+}
+
+bool seleccionarNivelSimd(NivelSimd nivel){
+
+    // No se puede escoger un nivel que el procesador no soporta
+    if (nivel > detectarNivelSimd()) {
+        return false;
+    }
+
+    kernelsActivos() = kernelsPara(nivel);
+    return true;
+
+}
+
+const char* nombreNivelSimd(NivelSimd nivel){
+
+    switch (nivel) {
+    case SIMD_ESCALAR: return "escalar";
+    case SIMD_SSE2:    return "sse2";
+    case SIMD_AVX2:    return "avx2";
+    case SIMD_AVX512:  return "avx512";
+    }
+
+    return "";
+
+}
+
+bool leerNivelSimd(const string& nombre, NivelSimd &nivel){
+
+    for (int n = SIMD_ESCALAR; n <= SIMD_AVX512; n++) {
+        if (nombre == nombreNivelSimd((NivelSimd)n)) {
+            nivel = (NivelSimd)n;
+            return true;
+        }
+    }
+
+    return false;
+
+}
+
+void xorBuffer(const unsigned char* origen, const unsigned char* IM, unsigned char* destino, size_t size){
+
+    kernelsActivos().xorBuf(origen, IM, destino, size);
+
+}
+
+// Cualquier n es válido (ver columnaBits); los candidatos usan de 1 a 8
+void desplazamientoIzqBuffer(const unsigned char* origen, unsigned char* destino, size_t size, int n){
+
+    (*kernelsActivos().nucleos)[OP_DESPLAZAMIENTO_IZQ][columnaBits(OP_DESPLAZAMIENTO_IZQ, n)](origen, destino, size);
+
+}
+
+void desplazamientoDerBuffer(const unsigned char* origen, unsigned char* destino, size_t size, int n){
+
+    (*kernelsActivos().nucleos)[OP_DESPLAZAMIENTO_DER][columnaBits(OP_DESPLAZAMIENTO_DER, n)](origen, destino, size);
+
+}
+
+void rotacionIzqBuffer(const unsigned char* origen, unsigned char* destino, size_t size, int n){
+
+    (*kernelsActivos().nucleos)[OP_ROTACION_IZQ][columnaBits(OP_ROTACION_IZQ, n)](origen, destino, size);
+
+}
+
+void rotacionDerBuffer(const unsigned char* origen, unsigned char* destino, size_t size, int n){
+
+    (*kernelsActivos().nucleos)[OP_ROTACION_DER][columnaBits(OP_ROTACION_DER, n)](origen, destino, size);
+
+}
+
+TablaNibbles prepararNibbles(const unsigned char tabla[256]){
+    /*
+ * @brief Revisa si la tabla solo mueve o elimina bits (como cualquier composición de rotaciones y desplazamientos)
+ * y en ese caso arma sus tablas de nibbles.
+ */
+
+    TablaNibbles nibbles;
+    nibbles.valida = (tabla[0] == 0);
+
+    for (int x = 0; x < 256 && nibbles.valida; x++) {
+        nibbles.valida = (tabla[x] == (tabla[x & 0x0F] | tabla[x & 0xF0]));
+    }
+
+    if (!nibbles.valida) return nibbles;
+
+    for (int x = 0; x < 16; x++) {
+        nibbles.bajo[x] = tabla[x];
+        nibbles.alto[x] = tabla[x << 4];
+    }
+
+    return nibbles;
+
+}
+
+void tablaBuffer(const unsigned char* origen, unsigned char* destino, size_t size, const unsigned char tabla[256]){
+
+    tablaBuffer(origen, destino, size, tabla, prepararNibbles(tabla));
+
+}
+
+void tablaBuffer(const unsigned char* origen, unsigned char* destino, size_t size, const unsigned char tabla[256], const TablaNibbles& nibbles){
+    /*
+ * @brief Aplica una tabla de 256 entradas a cada byte del buffer.
+ *
+ * Con tablas de nibbles válidas se aplica con búsquedas de nibbles vectorizadas; en otro caso se consulta byte a byte.
+ * Quien aplica la misma tabla muchas veces prepara los nibbles una sola vez (prepararNibbles).
+ */
+
+    if (!nibbles.valida) {
+        for (size_t i = 0; i < size; i++) destino[i] = tabla[origen[i]];
+        return;
+    }
+
+    kernelsActivos().tablaNibbles(origen, destino, size, nibbles.bajo.data(), nibbles.alto.data());
+
+}
+
+
+/* ************************************************** Cadena de operaciones compuestas *********************************************************** */
+
+array<unsigned char, 256> CadenaOperaciones::tablaIdentidad(){
+
+    array<unsigned char, 256> tabla;
+
+    for (int x = 0; x < 256; x++) tabla[x] = (unsigned char)x;
+
+    return tabla;
+
+}
+
+void agregarOperacion(CadenaOperaciones& cadena, Operacion op){
+    /*
+ * @brief Agrega una operación al final de la cadena.
+ *
+ * Una XOR abre una tabla nueva; cualquier otra operación se compone con la última tabla.
+ */
+
+    if (op.tipo == OP_XOR) {
+        cadena.tablas.push_back(CadenaOperaciones::tablaIdentidad());
+        cadena.identidad.push_back(true);
+        cadena.nibbles.push_back(TablaNibbles());
+        return;
+    }
+
+    array<unsigned char, 256>& tabla = cadena.tablas.back();
+    const unsigned char* siguiente = tablaOperacion(op);
+
+    for (unsigned char& x : tabla) x = siguiente[x];
+
+    cadena.identidad.back() = (tabla == CadenaOperaciones::tablaIdentidad());
+    cadena.nibbles.back() = prepararNibbles(tabla.data());
+
+}
+
+void aplicarCadena(const CadenaOperaciones& cadena, unsigned char* datos, const unsigned char* IM, size_t size){
+    /*
+ * @brief Aplica toda la cadena en el mismo lugar, en bloques que caben en la caché L1.
+ *
+ * Cada bloque pasa por todas las tablas y XOR antes de seguir con el siguiente, así que la memoria se recorre
+ * una sola vez sin importar cuántas operaciones tenga la cadena.
+ */
+
+    const size_t BYTES_BLOQUE = 16 * 1024;
+
+    for (size_t inicio = 0; inicio < size; inicio += BYTES_BLOQUE) {
+
+        size_t bytes = min(BYTES_BLOQUE, size - inicio);
+        unsigned char* bloque = datos + inicio;
+
+        for (size_t t = 0; t < cadena.tablas.size(); t++) {
+
+            if (t > 0) {
+                xorBuffer(bloque, IM + inicio, bloque, bytes);
+            }
+
+            if (!cadena.identidad[t]) {
+                tablaBuffer(bloque, bloque, bytes, cadena.tablas[t].data(), cadena.nibbles[t]);
+            }
+
+        }
+
+    }
+
+}
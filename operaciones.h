@@ -0,0 +1,126 @@
+#ifndef OPERACIONES_H
+#define OPERACIONES_H
+
+/* Operaciones a nivel de bits del Desafío 1
+ *
+ * Contiene las operaciones escalares (byte a byte), que se conservan como referencia, y las versiones
+ * vectorizadas que trabajan sobre buffers completos. Las versiones vectorizadas (SSE2, AVX2 y AVX-512)
+ * se escogen al iniciar el programa según lo que reporte CPUID para el procesador.
+ *
+ * Cada rotación y desplazamiento de 1 a 8 bits tiene su propio núcleo (Kernel<Tipo, N>) con la cantidad de bits
+ * fija al compilar: su tabla de 256 entradas se genera en tiempo de compilación y los bucles sobre buffers se
+ * escogen de una tabla de despacho constante, sin decidir nada por byte.
+ */
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/* ********************************** Operaciones escalares (referencia) ********************************** */
+
+unsigned char desplazamientoIzq(unsigned char Id, int n);
+unsigned char desplazamientoDer(unsigned char Id, int n);
+unsigned char rotacionIzq(unsigned char Id, int n);
+unsigned char rotacionDer(unsigned char Id, int n);
+unsigned char operacionXor(unsigned char Id, unsigned char IM);
+
+
+/* ********************************** Operaciones candidatas por etapa ********************************** */
+
+// Operación que se aplica a la imagen de la etapa para revertir la transformación original
+enum TipoOperacion { OP_XOR, OP_ROTACION_IZQ, OP_ROTACION_DER, OP_DESPLAZAMIENTO_IZQ, OP_DESPLAZAMIENTO_DER };
+
+struct Operacion {
+    TipoOperacion tipo;
+    int bits;           // Bits a rotar o desplazar (no se usa en la XOR)
+};
+
+// XOR, 8 rotaciones a la izquierda, 8 a la derecha, 8 desplazamientos a la izquierda y 8 a la derecha
+const int NUM_CANDIDATOS = 33;
+
+void generarCandidatos(Operacion* candidatos);
+void aplicarOperacion(Operacion op, const unsigned char* origen, unsigned char* destino, const unsigned char* IM, size_t size);
+std::string nombreOperacion(Operacion op);
+
+// true si la ventana [semilla, semilla + tamVentana) cabe en una imagen de totalBytes bytes (sin desbordar la suma)
+bool ventanaEnImagen(long long semilla, size_t tamVentana, size_t totalBytes);
+
+
+/* ********************************** Núcleos especializados al compilar ********************************** */
+
+// destino = ((origen << Izq) & 0xFF) | (origen >> Der), con 0 ≤ Izq, Der ≤ 8
+template <int Izq, int Der>
+constexpr unsigned char desplazarFijo(unsigned char x){
+
+    return (unsigned char)((((unsigned int)x << Izq) & 0xFF) | ((unsigned int)x >> Der));
+
+}
+
+// Rotación o desplazamiento de N bits escrito como desplazarFijo<izq, der>
+template <TipoOperacion Tipo, int N>
+struct Kernel {
+    static_assert(Tipo != OP_XOR && N >= 1 && N <= 8, "Kernel solo existe para rotaciones y desplazamientos de 1 a 8 bits");
+
+    static constexpr int izq = (Tipo == OP_ROTACION_IZQ || Tipo == OP_DESPLAZAMIENTO_IZQ) ? N : (Tipo == OP_ROTACION_DER ? 8 - N : 8);
+    static constexpr int der = (Tipo == OP_ROTACION_DER || Tipo == OP_DESPLAZAMIENTO_DER) ? N : (Tipo == OP_ROTACION_IZQ ? 8 - N : 8);
+
+    static constexpr unsigned char aplicar(unsigned char x){ return desplazarFijo<izq, der>(x); }
+
+    static constexpr std::array<unsigned char, 256> tabla = [] {
+        std::array<unsigned char, 256> t{};
+        for (int x = 0; x < 256; x++) t[x] = desplazarFijo<izq, der>((unsigned char)x);
+        return t;
+    }();
+};
+
+// Tabla de Kernel<op.tipo, op.bits> (nullptr para la XOR, que depende del byte de I_M). Las rotaciones se toman
+// módulo 8, los desplazamientos de más de 8 bits valen lo mismo que los de 8 y 0 bits da la identidad
+const unsigned char* tablaOperacion(Operacion op);
+
+
+/* ********************************** Operaciones sobre buffers completos ********************************** */
+
+// Juego de instrucciones usado por las operaciones sobre buffers
+enum NivelSimd { SIMD_ESCALAR, SIMD_SSE2, SIMD_AVX2, SIMD_AVX512 };
+
+NivelSimd detectarNivelSimd();
+NivelSimd nivelSimdActivo();
+bool seleccionarNivelSimd(NivelSimd nivel);
+const char* nombreNivelSimd(NivelSimd nivel);
+bool leerNivelSimd(const std::string& nombre, NivelSimd &nivel);
+
+void xorBuffer(const unsigned char* origen, const unsigned char* IM, unsigned char* destino, size_t size);
+void desplazamientoIzqBuffer(const unsigned char* origen, unsigned char* destino, size_t size, int n);
+void desplazamientoDerBuffer(const unsigned char* origen, unsigned char* destino, size_t size, int n);
+void rotacionIzqBuffer(const unsigned char* origen, unsigned char* destino, size_t size, int n);
+void rotacionDerBuffer(const unsigned char* origen, unsigned char* destino, size_t size, int n);
+
+// Una tabla que solo mueve o elimina bits se aplica como dos búsquedas de 16 entradas: bajo[x & 0x0F] | alto[x >> 4]
+struct TablaNibbles {
+    bool valida = false;
+    std::array<unsigned char, 16> bajo{};
+    std::array<unsigned char, 16> alto{};
+};
+
+TablaNibbles prepararNibbles(const unsigned char tabla[256]);
+void tablaBuffer(const unsigned char* origen, unsigned char* destino, size_t size, const unsigned char tabla[256]);
+void tablaBuffer(const unsigned char* origen, unsigned char* destino, size_t size, const unsigned char tabla[256], const TablaNibbles& nibbles);
+
+
+/* ********************************** Cadena de operaciones compuestas ********************************** */
+
+// Secuencia de operaciones reducida a tablas[0], XOR con I_M, tablas[1], XOR con I_M, ..., tablas[k]: las
+// rotaciones y desplazamientos seguidos quedan en una sola tabla de 256 entradas
+struct CadenaOperaciones {
+    std::vector<std::array<unsigned char, 256>> tablas = {tablaIdentidad()};
+    std::vector<bool> identidad = {true};          // La tabla i no cambia ningún byte (se omite al aplicar)
+    std::vector<TablaNibbles> nibbles = {TablaNibbles()};     // Preparadas al componer, no en cada bloque
+
+    static std::array<unsigned char, 256> tablaIdentidad();
+};
+
+void agregarOperacion(CadenaOperaciones& cadena, Operacion op);
+void aplicarCadena(const CadenaOperaciones& cadena, unsigned char* datos, const unsigned char* IM, size_t size);
+
+#endif // OPERACIONES_H
@@ -0,0 +1,292 @@
+#include "paralelo.h"
+
+#include <algorithm>
+
+using namespace std;
+
+
+/* ************************************************** Pool de hilos *********************************************************** */
+
+// Cola de tareas de un hilo: el dueño saca por el frente y los demás roban por el fondo
+struct ColaTareas {
+    mutex candado;
+    deque<int> tareas;
+
+    bool sacarFrente(int &tarea){
+        lock_guard<mutex> guardia(candado);
+        if (tareas.empty()) return false;
+        tarea = tareas.front();
+        tareas.pop_front();
+        return true;
+    }
+
+    bool sacarFondo(int &tarea){
+        lock_guard<mutex> guardia(candado);
+        if (tareas.empty()) return false;
+        tarea = tareas.back();
+        tareas.pop_back();
+        return true;
+    }
+};
+
+PoolHilos::PoolHilos(int cantidad){
+
+    if (cantidad <= 0) {
+        cantidad = (int)thread::hardware_concurrency();
+    }
+
+    if (cantidad <= 0) {
+        cantidad = 1;
+    }
+
+    // El hilo que llama a ejecutar() cuenta como uno de los hilos del pool
+    for (int i = 1; i < cantidad; i++) {
+        hilos.emplace_back(&PoolHilos::trabajar, this, i);
+    }
+
+    colasRobo = vector<ColaTareas>(cantidad);
+
+}
+
+PoolHilos::~PoolHilos(){
+
+    {
+        lock_guard<mutex> guardia(candado);
+        terminar = true;
+    }
+
+    hayTrabajo.notify_all();
+
+    for (thread& hilo : hilos) {
+        hilo.join();
+    }
+
+}
+
+int PoolHilos::cantidadHilos() const{
+
+    return (int)hilos.size() + 1;
+
+}
+
+void PoolHilos::ejecutar(int tareas, const function<void(int)>& tarea){
+
+    if (tareas <= 0) {
+        return;
+    }
+
+    // Sin hilos adicionales o con una sola tarea no vale la pena despertar a nadie
+    if (hilos.empty() || tareas == 1) {
+        for (int i = 0; i < tareas; i++) tarea(i);
+        return;
+    }
+
+    // El estado del reparto va en una estructura para que la lambda capture una sola referencia y quepa dentro
+    // del std::function, sin reservar memoria en cada llamada
+    struct Reparto {
+        atomic<int> siguiente;
+        int tareas;
+        const function<void(int)>& tarea;
+    } reparto = {{0}, tareas, tarea};
+
+    enTodosLosHilos([&reparto](int){
+
+        int i;
+
+        while ((i = reparto.siguiente.fetch_add(1)) < reparto.tareas) {
+            reparto.tarea(i);
+        }
+
+    });
+
+}
+
+void PoolHilos::ejecutarConRobo(int tareas, const function<void(int)>& tarea){
+
+    if (tareas <= 0) {
+        return;
+    }
+
+    if (hilos.empty() || tareas == 1) {
+        for (int i = 0; i < tareas; i++) tarea(i);
+        return;
+    }
+
+    // Solo un trabajo a la vez usa las colas del pool (se conservan entre llamadas para no reservarlas de nuevo)
+    lock_guard<mutex> unTrabajo(candadoRobo);
+
+    struct Reparto {
+        vector<ColaTareas>& colas;
+        int participantes;
+        const function<void(int)>& tarea;
+    } reparto = {colasRobo, cantidadHilos(), tarea};
+
+    // Reparto intercalado: cada hilo empieza por una de las tareas de mayor prioridad
+    for (int i = 0; i < tareas; i++) {
+        colasRobo[i % reparto.participantes].tareas.push_back(i);
+    }
+
+    enTodosLosHilos([&reparto](int participante){
+
+        int i;
+
+        while (true) {
+
+            bool hayTarea = reparto.colas[participante].sacarFrente(i);
+
+            for (int otro = 1; otro < reparto.participantes && !hayTarea; otro++) {
+                hayTarea = reparto.colas[(participante + otro) % reparto.participantes].sacarFondo(i);
+            }
+
+            // No se agregan tareas nuevas, así que si todas las colas están vacías ya no hay trabajo
+            if (!hayTarea) {
+                return;
+            }
+
+            reparto.tarea(i);
+
+        }
+
+    });
+
+}
+
+void PoolHilos::enTodosLosHilos(const function<void(int participante)>& trabajo){
+
+    // Solo un trabajo a la vez: si otro hilo llama a ejecutar() espera a que este termine
+    lock_guard<mutex> unTrabajo(candadoEjecucion);
+
+    {
+        lock_guard<mutex> guardia(candado);
+        trabajoActual = &trabajo;
+        hilosOcupados = (int)hilos.size();
+        generacion++;
+    }
+
+    hayTrabajo.notify_all();
+
+    // El hilo que llama es el participante 0
+    trabajo(0);
+
+    unique_lock<mutex> guardia(candado);
+    trabajoTerminado.wait(guardia, [this]{ return hilosOcupados == 0; });
+    trabajoActual = nullptr;
+
+}
+
+void PoolHilos::trabajar(int participante){
+
+    unsigned long long vista = 0;
+
+    while (true) {
+
+        const function<void(int)>* trabajo;
+
+        {
+            unique_lock<mutex> guardia(candado);
+            hayTrabajo.wait(guardia, [&]{ return terminar || generacion != vista; });
+
+            if (terminar) {
+                return;
+            }
+
+            vista = generacion;
+            trabajo = trabajoActual;
+        }
+
+        (*trabajo)(participante);
+
+        lock_guard<mutex> guardia(candado);
+
+        if (--hilosOcupados == 0) {
+            trabajoTerminado.notify_one();
+        }
+
+    }
+
+}
+
+
+/* ************************************************** Franjas de la imagen *********************************************************** */
+
+void ejecutarEnFranjas(PoolHilos& pool, size_t totalBytes, size_t bytesFila, const function<void(size_t inicio, size_t fin)>& franja){
+    /*
+ * @brief Divide un buffer de imagen en franjas de filas y las procesa en paralelo.
+ *
+ * Se generan unas cuatro franjas por hilo para repartir bien la carga, con un mínimo de 64 KiB por franja
+ * para que el costo de repartir no supere al de procesar. El tamaño de cada franja se redondea a un
+ * múltiplo de la línea de caché, de modo que los límites entre hilos quedan alineados.
+ *
+ * @param pool Pool de hilos que ejecuta las franjas.
+ * @param totalBytes Tamaño del buffer en bytes.
+ * @param bytesFila Bytes de una fila de la imagen (ancho × 3).
+ * @param franja Función que procesa los bytes [inicio, fin).
+ */
+
+    if (totalBytes == 0) {
+        return;
+    }
+
+    if (bytesFila == 0) {
+        bytesFila = totalBytes;
+    }
+
+    const size_t minimoFranja = 64 * 1024;
+
+    size_t filas = (totalBytes + bytesFila - 1) / bytesFila;
+    size_t filasPorFranja = max<size_t>(1, filas / ((size_t)pool.cantidadHilos() * 4));
+
+    size_t bytesFranja = max(filasPorFranja * bytesFila, minimoFranja);
+    bytesFranja = (bytesFranja + BYTES_LINEA_CACHE - 1) / BYTES_LINEA_CACHE * BYTES_LINEA_CACHE;
+
+    int franjas = (int)((totalBytes + bytesFranja - 1) / bytesFranja);
+
+    struct Reparto {
+        size_t totalBytes;
+        size_t bytesFranja;
+        const function<void(size_t, size_t)>& franja;
+    } reparto = {totalBytes, bytesFranja, franja};
+
+    pool.ejecutar(franjas, [&reparto](int f){
+
+        size_t inicio = (size_t)f * reparto.bytesFranja;
+        size_t fin = min(inicio + reparto.bytesFranja, reparto.totalBytes);
+
+        reparto.franja(inicio, fin);
+
+    });
+
+}
+
+void aplicarOperacionEnFranjas(PoolHilos& pool, Operacion op, const unsigned char* origen, unsigned char* destino, const unsigned char* IM, size_t size, size_t bytesFila){
+
+    struct Buffers {
+        Operacion op;
+        const unsigned char* origen;
+        unsigned char* destino;
+        const unsigned char* IM;
+    } buffers = {op, origen, destino, IM};
+
+    ejecutarEnFranjas(pool, size, bytesFila, [&buffers](size_t inicio, size_t fin){
+
+        aplicarOperacion(buffers.op, buffers.origen + inicio, buffers.destino + inicio, buffers.IM != nullptr ? buffers.IM + inicio : nullptr, fin - inicio);
+
+    });
+
+}
+
+void aplicarCadenaEnFranjas(PoolHilos& pool, const CadenaOperaciones& cadena, unsigned char* datos, const unsigned char* IM, size_t size, size_t bytesFila){
+
+    struct Buffers {
+        const CadenaOperaciones& cadena;
+        unsigned char* datos;
+        const unsigned char* IM;
+    } buffers = {cadena, datos, IM};
+
+    ejecutarEnFranjas(pool, size, bytesFila, [&buffers](size_t inicio, size_t fin){
+
+        aplicarCadena(buffers.cadena, buffers.datos + inicio, buffers.IM != nullptr ? buffers.IM + inicio : nullptr, fin - inicio);
+
+    });
+
+}
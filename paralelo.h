@@ -0,0 +1,67 @@
+#ifndef PARALELO_H
+#define PARALELO_H
+
+/* Ejecución en paralelo de las operaciones sobre la imagen completa
+ *
+ * Todas las operaciones a nivel de bits trabajan byte a byte, así que la imagen se divide en franjas de filas
+ * consecutivas y cada hilo procesa franjas completas. Los límites de las franjas caen en múltiplos de 64 bytes
+ * para que dos hilos nunca escriban en la misma línea de caché.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "operaciones.h"
+
+struct ColaTareas;
+
+class PoolHilos {
+public:
+    // hilos <= 0 usa std::thread::hardware_concurrency()
+    explicit PoolHilos(int hilos = 0);
+    ~PoolHilos();
+
+    PoolHilos(const PoolHilos&) = delete;
+    PoolHilos& operator=(const PoolHilos&) = delete;
+
+    int cantidadHilos() const;
+
+    // Ejecuta tarea(0) ... tarea(tareas - 1) repartidas entre los hilos y espera a que terminen todas.
+    // El hilo que llama también procesa tareas.
+    void ejecutar(int tareas, const std::function<void(int)>& tarea);
+
+    // Igual que ejecutar(), pero cada hilo tiene su propia cola de tareas en orden de prioridad (índice menor primero)
+    // y, cuando la vacía, roba las de menor prioridad de las colas de los demás.
+    void ejecutarConRobo(int tareas, const std::function<void(int)>& tarea);
+
+private:
+    void enTodosLosHilos(const std::function<void(int participante)>& trabajo);
+    void trabajar(int participante);
+
+    std::vector<std::thread> hilos;
+    std::vector<ColaTareas> colasRobo;      // Una por participante, para ejecutarConRobo()
+    std::mutex candado;
+    std::mutex candadoEjecucion;
+    std::mutex candadoRobo;
+    std::condition_variable hayTrabajo;
+    std::condition_variable trabajoTerminado;
+
+    const std::function<void(int)>* trabajoActual = nullptr;
+    int hilosOcupados = 0;
+    unsigned long long generacion = 0;
+    bool terminar = false;
+};
+
+const size_t BYTES_LINEA_CACHE = 64;
+
+void ejecutarEnFranjas(PoolHilos& pool, size_t totalBytes, size_t bytesFila, const std::function<void(size_t inicio, size_t fin)>& franja);
+void aplicarOperacionEnFranjas(PoolHilos& pool, Operacion op, const unsigned char* origen, unsigned char* destino, const unsigned char* IM, size_t size, size_t bytesFila);
+void aplicarCadenaEnFranjas(PoolHilos& pool, const CadenaOperaciones& cadena, unsigned char* datos, const unsigned char* IM, size_t size, size_t bytesFila);
+
+#endif // PARALELO_H
@@ -0,0 +1,672 @@
+#include "reconstruccion.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+
+/* ************************************************** Reconstrucción de un caso *********************************************************** */
+
+static double segundosDesde(chrono::steady_clock::time_point inicio){
+
+    return chrono::duration<double>(chrono::steady_clock::now() - inicio).count();
+
+}
+
+// Copia los bytes de los intervalos de 'ventanas', uno tras otro, en 'destino' (la copia compacta)
+static void copiarVentanas(const VentanasCaso& ventanas, const unsigned char* origen, unsigned char* destino){
+
+    size_t posicion = 0;
+
+    for (const pair<size_t, size_t>& intervalo : ventanas.intervalos) {
+        memcpy(destino + posicion, origen + intervalo.first, intervalo.second - intervalo.first);
+        posicion += intervalo.second - intervalo.first;
+    }
+
+}
+
+// Operación que deshace una XOR o una rotación (los desplazamientos pierden bits y no tienen inversa)
+static Operacion operacionReversa(Operacion op){
+
+    if (op.tipo == OP_ROTACION_IZQ) return {OP_ROTACION_DER, op.bits};
+    if (op.tipo == OP_ROTACION_DER) return {OP_ROTACION_IZQ, op.bits};
+
+    return op;
+
+}
+
+// Imagen sobre la que se revierten las etapas: la imagen completa o la copia compacta de las ventanas
+struct ImagenEtapas {
+    unsigned char* datos;
+    const unsigned char* im;                    // I_M en las mismas posiciones que datos
+    size_t tam;
+    size_t bytesFila;                           // Para repartir las operaciones en franjas
+    span<const long long> inicios;              // Posición de la ventana de cada etapa en datos; -1 si no cabe en la imagen
+};
+
+static ResultadoReconstruccion revertirEtapas(const ImagenEtapas& trabajo, const VistaImagen& mascara, span<const EtapaEnmascaramiento> etapas, const ConfiguracionReconstruccion& config, const ObservadorReconstruccion& observador){
+    /*
+ * @brief Ciclo de etapas común a reconstruir y reconstruirVentanas.
+ *
+ * Como todas las operaciones son byte a byte, el resultado sobre cada byte de datos es el mismo tanto si datos
+ * es la imagen completa como si es solo la unión de las ventanas de enmascaramiento.
+ *
+ * Si una etapa no se puede explicar con una operación y antes se revirtió una etapa con alternativas que no son
+ * equivalentes, la búsqueda con retroceso empieza en esa etapa (la primera de ellas que se revirtió), desde una
+ * copia de datos guardada al empezarla: una elección anterior también puede ser la que deja sin solución a las
+ * siguientes. El observador vuelve a recibir las etapas que se revierten otra vez.
+ *
+ * Del punto de retroceso solo se guarda la unión de las ventanas de enmascaramiento, que es lo único que lee la
+ * búsqueda. Para volver a él, las XOR y rotaciones aplicadas desde entonces se deshacen con su inversa; solo si se
+ * aplica un desplazamiento (que pierde bits) se copian los datos antes de aplicarlo.
+ */
+
+    ResultadoReconstruccion resultado;
+    int n = (int)etapas.size();
+
+    PoolHilos serial(1);
+    PoolHilos& pool = (config.pool != nullptr) ? *config.pool : serial;
+
+    unsigned char* validacData = trabajo.datos;
+    const unsigned char* ImaskData = trabajo.im;
+    span<uint8_t> imagen(trabajo.datos, trabajo.tam);
+
+    // Candidatos en el orden de prioridad con el que se prueban en cada etapa
+    Operacion candidatos[NUM_CANDIDATOS];
+    generarCandidatos(candidatos);
+
+    // Tablas de 256 entradas con el resultado de cada candidato (excepto la XOR, que depende de I_M)
+    unsigned char tablasCandidatos[NUM_CANDIDATOS][256];
+    generarTablas(candidatos, tablasCandidatos);
+
+    // Tamaño de la ventana de enmascaramiento: solo estos bytes, a partir de la semilla, deciden la operación
+    size_t tamVentana = mascara.pixeles.size();
+
+    // Bytes que debe tener la ventana de cada etapa al revertirla, S(k) - M(k); nullptr si alguna suma no tiene
+    // preimagen o la cantidad de valores no coincide con la máscara
+    vector<const unsigned char*> objetivos(n, nullptr);
+    vector<vector<uint8_t>> copiasObjetivos(n);
+
+    for (int e = 0; e < n; e++) {
+
+        if (etapas[e].objetivos.size() == (size_t)tamVentana) {
+            objetivos[e] = etapas[e].objetivos.data();
+        }
+        else if (etapas[e].objetivos.empty() && calcularObjetivos(etapas[e].sumas, mascara.pixeles, copiasObjetivos[e])) {
+            objetivos[e] = copiasObjetivos[e].data();
+        }
+
+    }
+
+    // Secuencias ya decididas por la búsqueda con retroceso para las etapas que faltan
+    vector<vector<Operacion>> plan(n);
+
+    // Las etapas del resultado se preparan antes del ciclo, con lugar para la operación y las alternativas, de modo
+    // que revertir una etapa no reserva memoria (salvo la búsqueda con retroceso)
+    vector<EtapaReconstruida> preparadas(n);
+    resultado.etapas.reserve(n);
+
+    for (EtapaReconstruida& preparada : preparadas) {
+        preparada.operaciones.reserve(1);
+        preparada.alternativas.reserve(NUM_CANDIDATOS - 1);
+    }
+
+    // Punto de retroceso: primera etapa revertida con alternativas que no son equivalentes, con sus ventanas (datos
+    // e I_M) copiadas al empezarla
+    int etapaRetroceso = -1;
+    VentanasCaso ventanasRetroceso;
+    vector<unsigned char> datosRetroceso;
+    vector<unsigned char> imRetroceso;
+
+    // Operaciones aplicadas a datos desde el punto de retroceso, para deshacerlas; si alguna es un desplazamiento,
+    // copia de datos antes del primero (las anteriores a la copia se deshacen después de restaurarla)
+    vector<Operacion> aplicadasDesdeRetroceso;
+    vector<unsigned char> datosAntesDesplazamiento;
+    size_t aplicadasAntesCopia = 0;
+
+    for (int etapa=n-1;etapa>=0;etapa--){
+
+        if (etapa!=n-1){
+
+            // Revertir enmascaramiento: la ventana de la etapa anterior vuelve a tener los bytes S(k) - M(k)
+            long long inicioAnterior = trabajo.inicios[etapa + 1];
+
+            if (objetivos[etapa + 1] != nullptr && inicioAnterior >= 0){
+                memcpy(validacData + inicioAnterior, objetivos[etapa + 1], tamVentana);
+            }
+
+        }
+
+        if (observador.inicioEtapa){
+            observador.inicioEtapa(etapa, imagen);
+        }
+
+        long long inicio1 = trabajo.inicios[etapa];
+        const unsigned char *objetivos1 = objetivos[etapa];
+
+        bool ventanaValida = (inicio1 >= 0 && objetivos1 != nullptr);
+
+        // Operaciones que revierten esta etapa
+        EtapaReconstruida revertida = move(preparadas[etapa]);
+        revertida.etapa = etapa;
+        revertida.semilla = etapas[etapa].semilla;
+        revertida.operaciones = plan[etapa];
+
+        // Un solo recorrido de la ventana descarta todos los candidatos que no coinciden con el enmascaramiento
+        ResultadoIdentificacion identificacion = {0, -1, 0};
+        auto inicio = chrono::steady_clock::now();
+
+        if (!revertida.operaciones.empty()){
+            // La etapa ya quedó resuelta por la búsqueda con retroceso
+        }
+        else if (ventanaValida && config.busquedaParalela){
+            identificacion = identificarOperacionParalela(pool, validacData + inicio1, ImaskData + inicio1, objetivos1, tamVentana, tablasCandidatos);
+        }
+        else if (ventanaValida){
+            identificacion = identificarOperacion(validacData + inicio1, ImaskData + inicio1, objetivos1, tamVentana, tablasCandidatos);
+        }
+
+        if (revertida.operaciones.empty() && ventanaValida){
+            revertida.candidatos = NUM_CANDIDATOS;
+            revertida.bytesRevisados = identificacion.bytesRevisados;
+        }
+
+        revertida.segundosIdentificacion = segundosDesde(inicio);
+
+        if (identificacion.elegido >= 0){
+
+            Operacion elegida = candidatos[identificacion.elegido];
+            revertida.operaciones.push_back(elegida);
+
+            // Si sobrevive más de un candidato se informa en lugar de escoger en silencio el de mayor prioridad
+            for (int c = identificacion.elegido + 1; c < NUM_CANDIDATOS; c++) {
+                if (identificacion.sobrevivientes & (1ULL << c)){
+
+                    // Distinto nombre pero la misma función de bytes
+                    bool equivalente = (candidatos[c].tipo != OP_XOR && elegida.tipo != OP_XOR && memcmp(tablasCandidatos[c], tablasCandidatos[identificacion.elegido], 256) == 0);
+
+                    revertida.alternativas.push_back({candidatos[c], equivalente});
+
+                    // Todavía no se aplicó la operación elegida: datos está como al empezar la etapa
+                    if (!equivalente && etapaRetroceso < 0){
+
+                        etapaRetroceso = etapa;
+                        ventanasRetroceso = calcularVentanas(trabajo.inicios, tamVentana, trabajo.tam);
+
+                        datosRetroceso.resize(ventanasRetroceso.bytes);
+                        imRetroceso.resize(ventanasRetroceso.bytes);
+                        copiarVentanas(ventanasRetroceso, validacData, datosRetroceso.data());
+                        copiarVentanas(ventanasRetroceso, ImaskData, imRetroceso.data());
+
+                        aplicadasDesdeRetroceso.reserve((size_t)(etapa + 1) * max(1, config.busqueda.maxOperaciones));
+
+                    }
+
+                }
+            }
+
+        }
+
+        // Ninguna operación individual explica la etapa: se buscan secuencias para esta y las etapas restantes,
+        // empezando en la etapa ya revertida que tenía alternativas si la hay
+        if (revertida.operaciones.empty()){
+
+            int desde = (etapaRetroceso > etapa) ? etapaRetroceso : etapa;
+            bool desdeRetroceso = (desde != etapa);
+
+            // Desde el punto de retroceso la búsqueda trabaja sobre la copia de sus ventanas
+            const unsigned char* datosBusqueda = desdeRetroceso ? datosRetroceso.data() : validacData;
+            const unsigned char* imBusqueda = desdeRetroceso ? imRetroceso.data() : ImaskData;
+            size_t bytesBusqueda = desdeRetroceso ? ventanasRetroceso.bytes : trabajo.tam;
+
+            vector<EtapaBusqueda> etapasBusqueda;
+
+            // Una etapa sin objetivos o cuya ventana no cabe queda como imposible para la búsqueda
+            for (int e = desde; e >= 0; e--) {
+                etapasBusqueda.push_back({desdeRetroceso ? ventanasRetroceso.inicios[e] : trabajo.inicios[e], objetivos[e]});
+            }
+
+            inicio = chrono::steady_clock::now();
+
+            ResultadoBusqueda busqueda = buscarReconstruccion(datosBusqueda, imBusqueda, bytesBusqueda, tamVentana, etapasBusqueda.data(), desde + 1, config.busqueda);
+
+            resultado.nodos = busqueda.nodos;
+            resultado.milisegundos = busqueda.milisegundos;
+            revertida.segundosBusqueda = segundosDesde(inicio);
+            revertida.nodosBusqueda = busqueda.nodos;
+
+            if (busqueda.estado != BUSQUEDA_ENCONTRADA){
+
+                resultado.estado = (busqueda.estado == BUSQUEDA_SIN_PRESUPUESTO) ? RECONSTRUCCION_SIN_PRESUPUESTO : RECONSTRUCCION_SIN_SOLUCION;
+                resultado.etapaFallida = etapa;
+
+                return resultado;
+
+            }
+
+            for (int e = desde; e >= 0; e--) {
+                plan[e] = busqueda.secuencias[desde - e];
+            }
+
+            // Se deshacen las etapas revertidas desde el punto de retroceso y se vuelven a revertir con el plan
+            if (desdeRetroceso){
+
+                if (observador.retroceso){
+                    observador.retroceso(etapa, desde);
+                }
+
+                size_t reversibles = aplicadasDesdeRetroceso.size();
+
+                if (!datosAntesDesplazamiento.empty()){
+                    memcpy(validacData, datosAntesDesplazamiento.data(), trabajo.tam);
+                    reversibles = aplicadasAntesCopia;
+                }
+
+                for (size_t i = reversibles; i-- > 0; ) {
+                    aplicarOperacionEnFranjas(pool, operacionReversa(aplicadasDesdeRetroceso[i]), validacData, validacData, ImaskData, trabajo.tam, trabajo.bytesFila);
+                }
+
+                aplicadasDesdeRetroceso.clear();
+                vector<unsigned char>().swap(datosAntesDesplazamiento);
+
+                resultado.etapas.erase(resultado.etapas.begin() + (n - 1 - desde), resultado.etapas.end());
+
+                preparadas[desde].segundosBusqueda = revertida.segundosBusqueda;
+                preparadas[desde].nodosBusqueda = revertida.nodosBusqueda;
+
+                etapa = desde + 1;
+                continue;
+
+            }
+
+            revertida.operaciones = plan[etapa];
+
+        }
+
+        // Aplica una sola vez la secuencia ganadora sobre la imagen completa, repartida por franjas entre los hilos
+        inicio = chrono::steady_clock::now();
+
+        for (const Operacion& op : revertida.operaciones) {
+
+            if (etapaRetroceso >= 0){
+
+                bool desplazamiento = (op.tipo == OP_DESPLAZAMIENTO_IZQ || op.tipo == OP_DESPLAZAMIENTO_DER);
+
+                if (desplazamiento && datosAntesDesplazamiento.empty()){
+                    datosAntesDesplazamiento.assign(validacData, validacData + trabajo.tam);
+                    aplicadasAntesCopia = aplicadasDesdeRetroceso.size();
+                }
+
+                aplicadasDesdeRetroceso.push_back(op);
+
+            }
+
+            aplicarOperacionEnFranjas(pool, op, validacData, validacData, ImaskData, trabajo.tam, trabajo.bytesFila);
+
+        }
+
+        revertida.segundosAplicacion = segundosDesde(inicio);
+
+        if (observador.etapaRevertida){
+            observador.etapaRevertida(revertida, imagen);
+        }
+
+        resultado.etapas.push_back(move(revertida));
+
+    }
+
+    return resultado;
+
+}
+
+ResultadoReconstruccion reconstruir(span<uint8_t> imagen, int ancho, int alto, const VistaImagen& imask, const VistaImagen& mascara, span<const EtapaEnmascaramiento> etapas, const ConfiguracionReconstruccion& config, const ObservadorReconstruccion& observador){
+    /*
+ * @brief Revierte todas las etapas de un caso, de la última a la primera, sobre la imagen de entrada.
+ *
+ * Para cada etapa identifica la operación que explica su enmascaramiento (o, si ninguna lo hace, busca
+ * secuencias para esta y las etapas restantes) y la aplica sobre la imagen completa, repartida en franjas
+ * entre los hilos del pool.
+ *
+ * @param imagen Imagen después de la última etapa (RGB888 sin padding); al terminar, la imagen reconstruida.
+ * @param ancho Ancho de la imagen.
+ * @param alto Alto de la imagen.
+ * @param imask Imagen I_M para las operaciones XOR (mismo tamaño que la imagen).
+ * @param mascara Máscara M.
+ * @param etapas Enmascaramiento de cada etapa, de la primera (M0) a la última.
+ * @param config Búsqueda paralela, límites de la búsqueda con retroceso y pool de hilos.
+ * @param observador Avisos opcionales al empezar y al revertir cada etapa.
+ *
+ * @return Las operaciones de cada etapa revertida y, si no se pudo terminar, el motivo.
+ */
+
+    ResultadoReconstruccion resultado;
+    size_t totalBytes = (size_t)ancho * alto * 3;
+    size_t tamVentana = mascara.pixeles.size();
+
+    // Asegurarse que las dimensiones coincidan: la XOR lee I_M en las mismas posiciones que la imagen
+    if (imask.ancho != ancho || imask.alto != alto || imagen.size() != totalBytes || imask.pixeles.size() != totalBytes || tamVentana != (size_t)mascara.ancho * mascara.alto * 3) {
+        resultado.estado = RECONSTRUCCION_DIMENSIONES;
+        return resultado;
+    }
+
+    // Sobre la imagen completa la ventana de cada etapa está en su propia semilla
+    vector<long long> inicios(etapas.size());
+
+    for (size_t e = 0; e < etapas.size(); e++) {
+        inicios[e] = ventanaEnImagen(etapas[e].semilla, tamVentana, totalBytes) ? etapas[e].semilla : -1;
+    }
+
+    ImagenEtapas trabajo = {imagen.data(), imask.pixeles.data(), totalBytes, (size_t)ancho * 3, inicios};
+
+    return revertirEtapas(trabajo, mascara, etapas, config, observador);
+
+}
+
+VentanasCaso calcularVentanas(span<const EtapaEnmascaramiento> etapas, size_t tamVentana, size_t totalBytes){
+
+    // La geometría de las ventanas es la misma que usa la búsqueda con retroceso (busqueda.cpp)
+    vector<long long> semillas;
+
+    for (const EtapaEnmascaramiento& etapa : etapas) {
+        semillas.push_back(etapa.semilla);
+    }
+
+    return calcularVentanas(semillas, tamVentana, totalBytes);
+
+}
+
+ResultadoReconstruccion reconstruirVentanas(span<uint8_t> ventanas, span<const uint8_t> imVentanas, const VentanasCaso& ubicacion, int ancho, const VistaImagen& mascara, span<const EtapaEnmascaramiento> etapas, const ConfiguracionReconstruccion& config, const ObservadorReconstruccion& observador){
+    /*
+ * @brief Identifica las operaciones de todas las etapas a partir de las ventanas de enmascaramiento solamente.
+ *
+ * Hace lo mismo que reconstruir, pero sobre la copia compacta de las ventanas (ver calcularVentanas), así que
+ * la memoria no depende del tamaño de la imagen. Las operaciones encontradas se aplican después a la imagen
+ * con la cadena de componerOperaciones. El observador recibe la copia compacta en lugar de la imagen.
+ *
+ * @param ventanas Bytes de la imagen después de la última etapa en los intervalos de ubicacion; se modifican.
+ * @param imVentanas Bytes de I_M en los mismos intervalos.
+ * @param ubicacion Intervalos y posición de la ventana de cada etapa, de calcularVentanas.
+ * @param ancho Ancho de la imagen completa (las operaciones se reparten en franjas de filas de la imagen).
+ */
+
+    ResultadoReconstruccion resultado;
+
+    if (ventanas.size() != ubicacion.bytes || imVentanas.size() != ubicacion.bytes || ubicacion.inicios.size() != etapas.size() || mascara.pixeles.size() != (size_t)mascara.ancho * mascara.alto * 3) {
+        resultado.estado = RECONSTRUCCION_DIMENSIONES;
+        return resultado;
+    }
+
+    ImagenEtapas trabajo = {ventanas.data(), imVentanas.data(), ventanas.size(), (size_t)ancho * 3, ubicacion.inicios};
+
+    return revertirEtapas(trabajo, mascara, etapas, config, observador);
+
+}
+
+CadenaOperaciones componerOperaciones(const ResultadoReconstruccion& plan){
+    /*
+ * @brief Reúne las operaciones de todas las etapas de un caso, en el orden en que se aplican, en una sola cadena.
+ *
+ * Antes de identificar cada etapa, reconstruir restaura la ventana de la etapa revertida antes con S(k) - M(k);
+ * pero esa ventana ya tiene esos bytes, porque su operación solo se aceptó si producía exactamente esos valores.
+ * Así que, en un resultado completo, aplicar la cadena a la imagen de entrada da la misma imagen reconstruida.
+ */
+
+    CadenaOperaciones cadena;
+
+    for (const EtapaReconstruida& etapa : plan.etapas) {
+        for (const Operacion& op : etapa.operaciones) {
+            agregarOperacion(cadena, op);
+        }
+    }
+
+    return cadena;
+
+}
+
+ResultadoReconstruccion reconstruirPerezosa(span<uint8_t> imagen, int ancho, int alto, const VistaImagen& imask, const VistaImagen& mascara, span<const EtapaEnmascaramiento> etapas, const ConfiguracionReconstruccion& config, const ObservadorReconstruccion& observador){
+    /*
+ * @brief Igual que reconstruir, pero la imagen completa se recorre una sola vez, al final (--lazy).
+ *
+ * Las etapas se identifican sobre una copia de las ventanas de enmascaramiento (reconstruirVentanas), donde
+ * cada operación cuesta solo lo que mide la máscara; después se aplica la cadena de todas las operaciones
+ * (componerOperaciones) en una sola pasada por la imagen, repartida en franjas entre los hilos. El observador
+ * recibe la copia de las ventanas en lugar de la imagen.
+ *
+ * @return Lo mismo que reconstruir; si no se pudo terminar, la imagen queda sin modificar.
+ */
+
+    ResultadoReconstruccion resultado;
+    size_t totalBytes = (size_t)ancho * alto * 3;
+    size_t tamVentana = mascara.pixeles.size();
+
+    // Asegurarse que las dimensiones coincidan: la XOR lee I_M en las mismas posiciones que la imagen
+    if (imask.ancho != ancho || imask.alto != alto || imagen.size() != totalBytes || imask.pixeles.size() != totalBytes || tamVentana != (size_t)mascara.ancho * mascara.alto * 3) {
+        resultado.estado = RECONSTRUCCION_DIMENSIONES;
+        return resultado;
+    }
+
+    VentanasCaso ubicacion = calcularVentanas(etapas, tamVentana, totalBytes);
+    vector<uint8_t> ventanas(ubicacion.bytes);
+    vector<uint8_t> imVentanas(ubicacion.bytes);
+
+    copiarVentanas(ubicacion, imagen.data(), ventanas.data());
+    copiarVentanas(ubicacion, imask.pixeles.data(), imVentanas.data());
+
+    resultado = reconstruirVentanas(ventanas, imVentanas, ubicacion, ancho, mascara, etapas, config, observador);
+
+    if (resultado.estado != RECONSTRUCCION_COMPLETA) {
+        return resultado;
+    }
+
+    PoolHilos serial(1);
+    PoolHilos& pool = (config.pool != nullptr) ? *config.pool : serial;
+
+    auto inicio = chrono::steady_clock::now();
+
+    aplicarCadenaEnFranjas(pool, componerOperaciones(resultado), imagen.data(), imask.pixeles.data(), totalBytes, (size_t)ancho * 3);
+
+    resultado.segundosAplicacionFinal = segundosDesde(inicio);
+
+    return resultado;
+
+}
+
+bool calcularObjetivos(span<const uint16_t> sumas, span<const uint8_t> mascara, vector<uint8_t>& objetivos){
+    /*
+ * @brief Calcula los bytes que debe tener la ventana transformada: T(ID)(k + s) = S(k) - M(k).
+ *
+ * @return false si la cantidad de sumas no coincide con la máscara o si alguna suma no tiene preimagen.
+ */
+
+    if (sumas.size() != mascara.size()) {
+        return false;
+    }
+
+    objetivos.resize(sumas.size());
+
+    for (size_t k = 0; k < sumas.size(); k++) {
+
+        int valor = (int)sumas[k] - (int)mascara[k];
+
+        if (valor < 0 || valor > 255) {
+            return false;
+        }
+
+        objetivos[k] = (uint8_t)valor;
+
+    }
+
+    return true;
+
+}
+
+bool verificarEnmascaramiento(span<const uint8_t> imagen, const VistaImagen& mascara, long long semilla, span<const uint16_t> sumas){
+    /*
+ * @brief Verifica el resultado del enmascaramiento de una etapa contra las sumas leídas de su archivo.
+ *
+ * Calcula S(k) = ID(k + s) + M(k) para 0 ≤ k < i × j × 3 directamente sobre la imagen transformada y lo
+ * compara con las sumas. La comparación termina en la primera diferencia encontrada.
+ *
+ * @param imagen Imagen transformada (RGB888 sin padding).
+ * @param mascara Máscara M.
+ * @param semilla Desplazamiento s del enmascaramiento.
+ * @param sumas Sumas esperadas en orden R, G, B, R, G, B, ...
+ *
+ * @return true si todas las sumas coinciden; false si hay alguna diferencia o los tamaños no son compatibles.
+ */
+
+    size_t totalM = mascara.pixeles.size();
+
+    // El archivo debe tener un triplete por cada píxel de la máscara
+    if (sumas.size() != totalM) {
+        return false;
+    }
+
+    // La ventana de enmascaramiento debe caber dentro de la imagen
+    if (!ventanaEnImagen(semilla, totalM, imagen.size())) {
+        return false;
+    }
+
+    for (size_t k = 0; k < totalM; k++) {
+
+        if ((unsigned int)imagen[semilla + k] + (unsigned int)mascara.pixeles[k] != sumas[k]){
+            return false;
+        }
+
+    }
+
+    return true;
+
+}
+
+
+/* ************************************************** Identificación de una etapa *********************************************************** */
+
+void generarTablas(Operacion* candidatos, unsigned char tablas[][256]){
+
+    for (int c = 0; c < NUM_CANDIDATOS; c++) {
+
+        // La XOR necesita el byte de I_M, así que su tabla se deja como identidad y no se consulta
+        if (candidatos[c].tipo == OP_XOR){
+            memcpy(tablas[c], CadenaOperaciones::tablaIdentidad().data(), 256);
+        }
+        else{
+            memcpy(tablas[c], tablaOperacion(candidatos[c]), 256);
+        }
+
+    }
+
+}
+
+// Descarta de 'sobrevivientes' los candidatos que no coinciden en los bytes [0, tam) de la ventana; termina antes si
+// no queda ninguno y suma a 'revisados' los bytes recorridos
+static unsigned long long filtrarCandidatos(unsigned long long sobrevivientes, const unsigned char* ventanaId, const unsigned char* ventanaIm, const unsigned char* objetivos, size_t tam, unsigned char tablas[][256], size_t& revisados){
+
+    for (size_t k = 0; k < tam && sobrevivientes != 0; k++) {
+
+        revisados++;
+
+        unsigned char objetivo = objetivos[k];
+        unsigned char x = ventanaId[k];
+
+        // Candidato 0: XOR con I_M
+        if ((sobrevivientes & 1ULL) && operacionXor(x, ventanaIm[k]) != objetivo){
+            sobrevivientes &= ~1ULL;
+        }
+
+        // Resto de candidatos: se consultan solo los que siguen vivos
+        unsigned long long vivos = sobrevivientes & ~1ULL;
+
+        while (vivos != 0) {
+
+            int c = __builtin_ctzll(vivos);
+            vivos &= vivos - 1;
+
+            if (tablas[c][x] != objetivo){
+                sobrevivientes &= ~(1ULL << c);
+            }
+
+        }
+
+    }
+
+    return sobrevivientes;
+
+}
+
+ResultadoIdentificacion identificarOperacion(const unsigned char* ventanaId, const unsigned char* ventanaIm, const unsigned char* objetivos, size_t tamVentana, unsigned char tablas[][256]){
+    /*
+ * @brief Identifica en un solo recorrido de la ventana qué candidatos revierten la etapa.
+ *
+ * Se mantiene una máscara de bits con los candidatos que siguen siendo consistentes. Para cada byte k de la
+ * ventana el valor esperado es S(k) - M(k); un candidato sobrevive si al aplicarlo a ID(k + s) obtiene ese valor.
+ * El recorrido termina cuando ya no queda ningún candidato o cuando se revisaron todos los bytes.
+ *
+ * @param ventanaId Bytes de la imagen de la etapa a partir de la semilla.
+ * @param ventanaIm Bytes de I_M a partir de la misma semilla (para la XOR).
+ * @param objetivos Valores esperados S(k) - M(k), calculados por objetivosEnmascaramiento.
+ * @param tamVentana Cantidad de bytes de la ventana (i × j × 3).
+ * @param tablas Tablas generadas por generarTablas en el mismo orden que los candidatos.
+ *
+ * @return Candidatos sobrevivientes y el primero de ellos en orden de prioridad.
+ */
+
+    ResultadoIdentificacion resultado;
+    resultado.bytesRevisados = 0;
+    resultado.sobrevivientes = filtrarCandidatos((1ULL << NUM_CANDIDATOS) - 1, ventanaId, ventanaIm, objetivos, tamVentana, tablas, resultado.bytesRevisados);
+    resultado.elegido = (resultado.sobrevivientes != 0) ? __builtin_ctzll(resultado.sobrevivientes) : -1;
+
+    return resultado;
+
+}
+
+ResultadoIdentificacion identificarOperacionParalela(PoolHilos& pool, const unsigned char* ventanaId, const unsigned char* ventanaIm, const unsigned char* objetivos, size_t tamVentana, unsigned char tablas[][256]){
+    /*
+ * @brief Igual que identificarOperacion, pero con la ventana repartida en tramos de bytes entre los hilos del pool.
+ *
+ * Cada tramo hace el mismo recorrido con máscara de bits sobre sus bytes, empezando por los candidatos que siguen
+ * vivos en los tramos ya terminados, y su máscara se combina con AND en la máscara común. Como un candidato solo
+ * sobrevive si coincide en todos los bytes, el resultado (todos los sobrevivientes, incluidas las alternativas de
+ * una etapa ambigua) es el mismo que el del recorrido secuencial. Si la máscara común queda vacía, los tramos que
+ * faltan no se recorren.
+ */
+
+    // Tramos de al menos 4 KiB, unos cuatro por hilo para repartir bien la carga
+    const size_t minimoTramo = 4096;
+    size_t tramos = min((size_t)pool.cantidadHilos() * 4, (tamVentana + minimoTramo - 1) / minimoTramo);
+    tramos = max<size_t>(tramos, 1);
+
+    size_t bytesTramo = (tamVentana + tramos - 1) / tramos;
+
+    atomic<unsigned long long> sobrevivientes((1ULL << NUM_CANDIDATOS) - 1);
+    atomic<size_t> bytesRevisados(0);
+
+    pool.ejecutar((int)tramos, [&](int t){
+
+        size_t inicio = (size_t)t * bytesTramo;
+        size_t fin = min(tamVentana, inicio + bytesTramo);
+        unsigned long long vivos = sobrevivientes.load(memory_order_relaxed);
+
+        if (inicio >= fin || vivos == 0){
+            return;
+        }
+
+        size_t revisados = 0;
+        vivos = filtrarCandidatos(vivos, ventanaId + inicio, ventanaIm + inicio, objetivos + inicio, fin - inicio, tablas, revisados);
+
+        sobrevivientes.fetch_and(vivos);
+        bytesRevisados += revisados;
+
+    });
+
+    ResultadoIdentificacion resultado;
+    resultado.sobrevivientes = sobrevivientes.load();
+    resultado.elegido = (resultado.sobrevivientes != 0) ? __builtin_ctzll(resultado.sobrevivientes) : -1;
+    resultado.bytesRevisados = bytesRevisados.load();
+
+    return resultado;
+
+}
@@ -0,0 +1,112 @@
+#ifndef RECONSTRUCCION_H
+#define RECONSTRUCCION_H
+
+/* Biblioteca de reconstrucción sobre buffers en memoria
+ *
+ * Identifica la operación de cada etapa, verifica enmascaramientos y revierte un caso completo a partir de
+ * vistas (std::span) de las imágenes y de los enmascaramientos ya leídos. No abre ni escribe archivos: el
+ * programa (main.cpp) o quien la enlace se encarga de decodificar las imágenes y de leer los M*.txt / .bin.
+ * La imagen de entrada se modifica en el lugar, sin copias.
+ *
+ * reconstruirVentanas identifica las operaciones con solo las ventanas de enmascaramiento; componerOperaciones
+ * las reúne después en una cadena que se aplica a la imagen en una sola pasada, completa (reconstruirPerezosa)
+ * o de a una franja de filas por vez para las imágenes que no caben en memoria.
+ *
+ * Se compila como biblioteca estática con Reconstruccion.pro.
+ */
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "busqueda.h"
+#include "operaciones.h"
+#include "paralelo.h"
+
+// Imagen RGB888 sin relleno, de la fila superior a la inferior
+struct VistaImagen {
+    std::span<const uint8_t> pixeles;
+    int ancho = 0;
+    int alto = 0;
+};
+
+// Resultado del enmascaramiento de una etapa ya leído de su archivo
+struct EtapaEnmascaramiento {
+    long long semilla = 0;
+    std::span<const uint16_t> sumas;            // S(k), R, G, B, ... (se ignoran si hay objetivos)
+    std::span<const uint8_t> objetivos;         // S(k) - M(k) ya calculados (p. ej. un .bin de preimágenes)
+};
+
+struct ConfiguracionReconstruccion {
+    bool busquedaParalela = false;              // Reparte la ventana de cada etapa entre los hilos del pool al identificar
+    ConfiguracionBusqueda busqueda;             // Límites de la búsqueda con retroceso
+    PoolHilos* pool = nullptr;                  // Hilos para las operaciones sobre la imagen; nullptr: el hilo que llama
+};
+
+// Otro candidato que también explica una etapa de una sola operación
+struct AlternativaOperacion {
+    Operacion operacion;
+    bool equivalente;                           // Misma función de bytes que la elegida (p. ej. rotar 3 a la derecha o 5 a la izquierda)
+};
+
+struct EtapaReconstruida {
+    int etapa;                                  // 0 = primera etapa del proceso
+    long long semilla;
+    std::vector<Operacion> operaciones;         // Secuencia que revierte la etapa, en orden de aplicación
+    std::vector<AlternativaOperacion> alternativas;
+
+    // Mediciones de la etapa
+    double segundosIdentificacion = 0;
+    double segundosBusqueda = 0;                // Búsqueda con retroceso que empezó en esta etapa (si la hubo)
+    double segundosAplicacion = 0;              // Operaciones sobre la imagen completa
+    int candidatos = 0;                         // Candidatos probados contra la ventana
+    long long bytesRevisados = 0;               // Bytes de la ventana recorridos al identificar
+    long long nodosBusqueda = 0;
+};
+
+enum EstadoReconstruccion { RECONSTRUCCION_COMPLETA, RECONSTRUCCION_DIMENSIONES, RECONSTRUCCION_SIN_SOLUCION, RECONSTRUCCION_SIN_PRESUPUESTO };
+
+struct ResultadoReconstruccion {
+    EstadoReconstruccion estado = RECONSTRUCCION_COMPLETA;
+    std::vector<EtapaReconstruida> etapas;      // De la última etapa a la primera, hasta donde se llegó
+    int etapaFallida = -1;                      // Etapa donde la búsqueda con retroceso no encontró solución
+    long long nodos = 0;                        // Secuencias evaluadas por la búsqueda con retroceso
+    long long milisegundos = 0;
+    double segundosAplicacionFinal = 0;         // Pasada única de reconstruirPerezosa sobre la imagen
+};
+
+// Avisos opcionales durante la reconstrucción, con la imagen en su estado en ese momento
+struct ObservadorReconstruccion {
+    std::function<void(int etapa, std::span<const uint8_t> imagen)> inicioEtapa;                   // Antes de identificar la etapa
+    std::function<void(const EtapaReconstruida& etapa, std::span<const uint8_t> imagen)> etapaRevertida;    // Con la operación ya revertida
+    std::function<void(int etapaFallida, int desde)> retroceso;     // Las etapas desde 'desde' se vuelven a revertir
+};
+
+ResultadoReconstruccion reconstruir(std::span<uint8_t> imagen, int ancho, int alto, const VistaImagen& imask, const VistaImagen& mascara, std::span<const EtapaEnmascaramiento> etapas, const ConfiguracionReconstruccion& config, const ObservadorReconstruccion& observador = {});
+VentanasCaso calcularVentanas(std::span<const EtapaEnmascaramiento> etapas, size_t tamVentana, size_t totalBytes);
+ResultadoReconstruccion reconstruirVentanas(std::span<uint8_t> ventanas, std::span<const uint8_t> imVentanas, const VentanasCaso& ubicacion, int ancho, const VistaImagen& mascara, std::span<const EtapaEnmascaramiento> etapas, const ConfiguracionReconstruccion& config, const ObservadorReconstruccion& observador = {});
+CadenaOperaciones componerOperaciones(const ResultadoReconstruccion& plan);
+ResultadoReconstruccion reconstruirPerezosa(std::span<uint8_t> imagen, int ancho, int alto, const VistaImagen& imask, const VistaImagen& mascara, std::span<const EtapaEnmascaramiento> etapas, const ConfiguracionReconstruccion& config, const ObservadorReconstruccion& observador = {});
+bool calcularObjetivos(std::span<const uint16_t> sumas, std::span<const uint8_t> mascara, std::vector<uint8_t>& objetivos);
+
+// Comprobación de referencia S(k) = ID(k + s) + M(k) sobre la imagen completa. La reconstrucción no la usa (cada
+// operación se acepta comparando la ventana con calcularObjetivos); queda para Benchmark y para quien enlace la biblioteca
+bool verificarEnmascaramiento(std::span<const uint8_t> imagen, const VistaImagen& mascara, long long semilla, std::span<const uint16_t> sumas);
+
+
+/* ************************************** Identificación de una etapa ************************************** */
+
+// Resultado de la identificación de la operación de una etapa
+struct ResultadoIdentificacion {
+    unsigned long long sobrevivientes;  // Bit c encendido: el candidato c coincide en toda la ventana
+    int elegido;                        // Primer sobreviviente en orden de prioridad (-1 si no hay)
+    size_t bytesRevisados;              // Bytes recorridos antes de terminar
+};
+
+void generarTablas(Operacion* candidatos, unsigned char tablas[][256]);
+ResultadoIdentificacion identificarOperacion(const unsigned char* ventanaId, const unsigned char* ventanaIm, const unsigned char* objetivos, size_t tamVentana, unsigned char tablas[][256]);
+ResultadoIdentificacion identificarOperacionParalela(PoolHilos& pool, const unsigned char* ventanaId, const unsigned char* ventanaIm, const unsigned char* objetivos, size_t tamVentana, unsigned char tablas[][256]);
+
+#endif // RECONSTRUCCION_H
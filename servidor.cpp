@@ -0,0 +1,503 @@
+#include "servidor.h"
+
+#include <iostream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+
+int ejecutarServidor(const string& rutaSocket, const AtenderPedido&, const EstadoServidor&){
+
+    cout<<"El modo servidor usa sockets Unix y no esta disponible en Windows ("<<rutaSocket<<")."<<endl;
+    return 1;
+
+}
+
+#else
+
+/* ************************************************** Lectura y escritura en el socket *********************************************************** */
+
+// Linux avisa con MSG_NOSIGNAL; macOS y los BSD con la opción SO_NOSIGPIPE del socket
+#ifdef MSG_NOSIGNAL
+static const int BANDERAS_ENVIO = MSG_NOSIGNAL;
+#else
+static const int BANDERAS_ENVIO = 0;
+#endif
+
+static bool enviarTodo(int fd, const char* datos, size_t bytes){
+    /*
+ * @brief Envía 'bytes' bytes completos; un cliente que cerró la conexión no termina el proceso con SIGPIPE.
+ */
+
+    while (bytes > 0) {
+
+        ssize_t enviados = send(fd, datos, bytes, BANDERAS_ENVIO);
+
+        if (enviados < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (enviados <= 0) {
+            return false;
+        }
+
+        datos += enviados;
+        bytes -= (size_t)enviados;
+
+    }
+
+    return true;
+
+}
+
+// Flujo que envía cada línea completa del informe como "INFO <texto>" en cuanto se vacía (endl o flush)
+class SalidaSocket : public streambuf {
+public:
+    explicit SalidaSocket(int fd) : fd(fd) {}
+
+    bool enviarLinea(const string& linea){
+
+        sync();
+
+        string texto = linea + '\n';
+        return enviarTodo(fd, texto.data(), texto.size());
+
+    }
+
+protected:
+    int_type overflow(int_type c) override{
+
+        if (c != traits_type::eof()) {
+            pendiente.push_back((char)c);
+        }
+
+        return traits_type::not_eof(c);
+
+    }
+
+    streamsize xsputn(const char* s, streamsize n) override{
+
+        pendiente.append(s, (size_t)n);
+        return n;
+
+    }
+
+    int sync() override{
+
+        size_t inicio = 0;
+        size_t fin;
+        string lineas;
+
+        while ((fin = pendiente.find('\n', inicio)) != string::npos) {
+
+            // Las líneas vacías del informe solo separan bloques en la consola
+            if (fin > inicio) {
+                lineas += "INFO ";
+                lineas.append(pendiente, inicio, fin - inicio + 1);
+            }
+
+            inicio = fin + 1;
+
+        }
+
+        pendiente.erase(0, inicio);
+
+        return (lineas.empty() || enviarTodo(fd, lineas.data(), lineas.size())) ? 0 : -1;
+
+    }
+
+private:
+    int fd;
+    string pendiente;
+};
+
+// Lectura con buffer de las líneas de comando y de los archivos que las siguen
+class LectorSocket {
+public:
+    explicit LectorSocket(int fd) : fd(fd) {}
+
+    bool leerLinea(string& linea){
+
+        size_t fin;
+
+        while ((fin = buffer.find('\n', inicio)) == string::npos) {
+
+            // Una línea de comando nunca debería ser tan larga
+            if (buffer.size() - inicio > 64 * 1024 || !recibir()) {
+                return false;
+            }
+
+        }
+
+        linea.assign(buffer, inicio, fin - inicio);
+        inicio = fin + 1;
+
+        if (!linea.empty() && linea.back() == '\r') {
+            linea.pop_back();
+        }
+
+        return true;
+
+    }
+
+    bool leerBytes(string& destino, size_t bytes){
+
+        destino.clear();
+
+        // Primero lo que ya quedó en el buffer; el resto se recibe directamente en el destino
+        size_t disponibles = min(bytes, buffer.size() - inicio);
+        destino.append(buffer, inicio, disponibles);
+        inicio += disponibles;
+
+        // El destino crece de a bloques a medida que llegan los datos: un cliente que anuncia un archivo grande
+        // y no lo envía no reserva esa memoria
+        const size_t BYTES_BLOQUE = (size_t)1 << 20;
+
+        for (size_t leidos = disponibles; leidos < bytes; ) {
+
+            if (leidos == destino.size()) {
+                destino.resize(min(bytes, leidos + BYTES_BLOQUE));
+            }
+
+            ssize_t recibidos = recv(fd, &destino[leidos], destino.size() - leidos, 0);
+
+            if (recibidos < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (recibidos <= 0) {
+                return false;
+            }
+
+            leidos += (size_t)recibidos;
+
+        }
+
+        return true;
+
+    }
+
+private:
+    bool recibir(){
+
+        if (inicio > 0) {
+            buffer.erase(0, inicio);
+            inicio = 0;
+        }
+
+        char bloque[4096];
+
+        for (;;) {
+
+            ssize_t recibidos = recv(fd, bloque, sizeof(bloque), 0);
+
+            if (recibidos < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (recibidos <= 0) {
+                return false;
+            }
+
+            buffer.append(bloque, (size_t)recibidos);
+            return true;
+
+        }
+
+    }
+
+    int fd;
+    string buffer;
+    size_t inicio = 0;
+};
+
+
+/* ************************************************** Pedidos *********************************************************** */
+
+static bool leerPedidoEnLinea(const string& argumentos, LectorSocket& lector, PedidoReconstruccion& pedido, string& error){
+    /*
+ * @brief Lee los tamaños de un pedido INLINE y, a continuación, el contenido de cada archivo.
+ *
+ * @param argumentos Lo que sigue a "INLINE" en la línea del comando.
+ *
+ * @return false con el error si la línea está mal formada, algún tamaño o la suma de todos supera los límites o la
+ * conexión se cerró.
+ */
+
+    istringstream linea(argumentos);
+    size_t bytesImagen = 0;
+    size_t bytesImask = 0;
+    size_t bytesMascara = 0;
+    size_t etapas = 0;
+
+    if (!(linea>>bytesImagen>>bytesImask>>bytesMascara>>etapas) || etapas == 0 || etapas > MAX_ETAPAS_PEDIDO) {
+        error = "INLINE espera <bytesI_D> <bytesI_M> <bytesM> <n> <bytesM0> ... <salida>, con 1 <= n <= " + to_string(MAX_ETAPAS_PEDIDO);
+        return false;
+    }
+
+    vector<size_t> bytesEtapas(etapas);
+
+    for (size_t e = 0; e < etapas; e++) {
+
+        if (!(linea>>bytesEtapas[e])) {
+            error = "INLINE: faltan tamaños de los archivos de enmascaramiento";
+            return false;
+        }
+
+    }
+
+    // La ruta de salida es el resto de la línea, con espacios incluidos
+    getline(linea>>ws, pedido.salida);
+
+    if (pedido.salida.empty()) {
+        error = "INLINE: falta la ruta de salida";
+        return false;
+    }
+
+    bytesEtapas.push_back(bytesImagen);
+    bytesEtapas.push_back(bytesImask);
+    bytesEtapas.push_back(bytesMascara);
+
+    size_t total = 0;
+
+    for (size_t bytes : bytesEtapas) {
+
+        if (bytes == 0 || bytes > MAX_BYTES_ARCHIVO_PEDIDO) {
+            error = "INLINE: cada archivo debe tener entre 1 y " + to_string(MAX_BYTES_ARCHIVO_PEDIDO) + " bytes";
+            return false;
+        }
+
+        // Se compara con lo que falta para el límite en lugar de sumar, para no desbordar
+        if (bytes > MAX_BYTES_PEDIDO - total) {
+            error = "INLINE: el pedido completo no puede superar " + to_string(MAX_BYTES_PEDIDO) + " bytes";
+            return false;
+        }
+
+        total += bytes;
+
+    }
+
+    pedido.enmascaramientos.resize(etapas);
+
+    bool completo = lector.leerBytes(pedido.imagen, bytesImagen) && lector.leerBytes(pedido.imask, bytesImask) && lector.leerBytes(pedido.mascara, bytesMascara);
+
+    for (size_t e = 0; completo && e < etapas; e++) {
+        completo = lector.leerBytes(pedido.enmascaramientos[e], bytesEtapas[e]);
+    }
+
+    if (!completo) {
+        error = "INLINE: la conexion se cerro antes de recibir todos los archivos";
+    }
+
+    return completo;
+
+}
+
+static bool atenderConexion(int fd, const AtenderPedido& atender, const EstadoServidor& estado){
+    /*
+ * @brief Atiende los comandos de un cliente hasta FIN, SALIR o el cierre de la conexión.
+ *
+ * @return true si el cliente pidió detener el servidor.
+ */
+
+    LectorSocket lector(fd);
+    SalidaSocket salida(fd);
+    ostream informe(&salida);
+    string linea;
+
+    while (lector.leerLinea(linea)) {
+
+        size_t espacio = linea.find(' ');
+        string comando = linea.substr(0, espacio);
+        string argumentos = (espacio == string::npos) ? "" : linea.substr(espacio + 1);
+
+        if (comando == "FIN") {
+            return false;
+        }
+
+        if (comando == "SALIR") {
+            salida.enviarLinea("OK");
+            return true;
+        }
+
+        if (comando == "ESTADO") {
+            estado(informe);
+            informe.flush();
+            salida.enviarLinea("OK");
+            continue;
+        }
+
+        PedidoReconstruccion pedido;
+        string error;
+        string archivoFinal;
+
+        if (comando == "CASO" && !argumentos.empty()) {
+            pedido.directorio = argumentos;
+        }
+        else if (comando == "INLINE") {
+
+            // Un pedido mal formado deja el resto de los bytes sin saber dónde termina: se cierra la conexión
+            if (!leerPedidoEnLinea(argumentos, lector, pedido, error)) {
+                salida.enviarLinea("ERROR " + error);
+                return false;
+            }
+
+        }
+        else {
+            salida.enviarLinea("ERROR comando desconocido: " + comando);
+            continue;
+        }
+
+        bool reconstruido = atender(pedido, informe, archivoFinal);
+        informe.flush();
+
+        if (!salida.enviarLinea(reconstruido ? "OK " + archivoFinal : "ERROR no se pudo reconstruir el caso")) {
+            return false;
+        }
+
+    }
+
+    return false;
+
+}
+
+
+/* ************************************************** Servidor *********************************************************** */
+
+int ejecutarServidor(const string& rutaSocket, const AtenderPedido& atender, const EstadoServidor& estado){
+    /*
+ * @brief Escucha en un socket Unix y atiende cada conexión en su propio hilo hasta que un cliente envía SALIR.
+ *
+ * Hay a lo sumo MAX_CONEXIONES_SERVIDOR hilos a la vez: con ese número de clientes conectados, la conexión
+ * nueva recibe un ERROR y se cierra sin crear un hilo.
+ *
+ * Un archivo que ya exista en la ruta del socket (de un servidor anterior que no terminó bien) se reemplaza.
+ *
+ * @param rutaSocket Ruta del socket en el sistema de archivos.
+ * @param atender Reconstruye un pedido; se llama desde varios hilos a la vez.
+ * @param estado Escribe las estadísticas para ESTADO.
+ *
+ * @return 0 al detenerse con SALIR, 1 si no se pudo abrir el socket.
+ */
+
+    sockaddr_un direccion;
+    memset(&direccion, 0, sizeof(direccion));
+    direccion.sun_family = AF_UNIX;
+
+    if (rutaSocket.empty() || rutaSocket.size() >= sizeof(direccion.sun_path)) {
+        cout<<"Ruta de socket invalida: "<<rutaSocket<<endl;
+        return 1;
+    }
+
+    memcpy(direccion.sun_path, rutaSocket.c_str(), rutaSocket.size() + 1);
+
+    int escucha = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (escucha < 0) {
+        cout<<"No se pudo crear el socket: "<<strerror(errno)<<endl;
+        return 1;
+    }
+
+    unlink(rutaSocket.c_str());
+
+    if (bind(escucha, (sockaddr*)&direccion, sizeof(direccion)) != 0 || listen(escucha, 16) != 0) {
+        cout<<"No se pudo escuchar en "<<rutaSocket<<": "<<strerror(errno)<<endl;
+        close(escucha);
+        return 1;
+    }
+
+    cout<<"Escuchando en "<<rutaSocket<<endl;
+
+    atomic<bool> detener(false);
+    mutex candado;
+    condition_variable sinConexiones;
+    vector<int> conexiones;
+
+    for (;;) {
+
+        int cliente = accept(escucha, nullptr, nullptr);
+
+        if (detener.load()) {
+            if (cliente >= 0) {
+                close(cliente);
+            }
+            break;
+        }
+
+        if (cliente < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            cout<<"Error al aceptar una conexion: "<<strerror(errno)<<endl;
+            break;
+        }
+
+#ifdef SO_NOSIGPIPE
+        int uno = 1;
+        setsockopt(cliente, SOL_SOCKET, SO_NOSIGPIPE, &uno, sizeof(uno));
+#endif
+
+        {
+            lock_guard<mutex> guardia(candado);
+
+            if (conexiones.size() >= MAX_CONEXIONES_SERVIDOR) {
+                string rechazo = "ERROR el servidor ya atiende " + to_string(MAX_CONEXIONES_SERVIDOR) + " conexiones\n";
+                enviarTodo(cliente, rechazo.data(), rechazo.size());
+                close(cliente);
+                continue;
+            }
+
+            conexiones.push_back(cliente);
+        }
+
+        thread([&, cliente](){
+
+            if (atenderConexion(cliente, atender, estado) && !detener.exchange(true)) {
+                // Despierta al accept() del hilo principal
+                shutdown(escucha, SHUT_RDWR);
+            }
+
+            lock_guard<mutex> guardia(candado);
+
+            conexiones.erase(find(conexiones.begin(), conexiones.end(), cliente));
+            close(cliente);
+            sinConexiones.notify_all();
+
+        }).detach();
+
+    }
+
+    // Los clientes que siguen conectados terminan el pedido en curso y ven la conexión cerrada al leer el siguiente
+    unique_lock<mutex> guardia(candado);
+
+    for (int cliente : conexiones) {
+        shutdown(cliente, SHUT_RD);
+    }
+
+    sinConexiones.wait(guardia, [&](){ return conexiones.empty(); });
+
+    close(escucha);
+    unlink(rutaSocket.c_str());
+
+    cout<<"Servidor detenido."<<endl;
+
+    return 0;
+
+}
+
+#endif
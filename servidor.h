@@ -0,0 +1,58 @@
+#ifndef SERVIDOR_H
+#define SERVIDOR_H
+
+/* Servidor de reconstrucciones sobre un socket Unix (--daemon)
+ *
+ * El proceso queda abierto con las cachés de I_M y M calientes y atiende pedidos de varios clientes a la vez,
+ * uno por conexión. El protocolo es de líneas de texto:
+ *
+ *      CASO <directorio>                   Reconstruye un directorio como --batch
+ *      INLINE <bytesI_D> <bytesI_M> <bytesM> <n> <bytesM0> ... <bytesM{n-1}> <salida>
+ *                                          Seguido de los archivos completos en ese orden; la imagen
+ *                                          reconstruida se escribe en <salida>
+ *      ESTADO                              Estadísticas de la caché de imágenes
+ *      FIN                                 Cierra la conexión
+ *      SALIR                               Cierra la conexión y detiene el servidor
+ *
+ * Si ya hay MAX_CONEXIONES_SERVIDOR clientes conectados, la conexión nueva recibe "ERROR ..." y se cierra.
+ *
+ * Mientras se reconstruye, cada línea del informe (operaciones detectadas, advertencias) se envía en cuanto se
+ * escribe como "INFO <texto>". Cada pedido termina con "OK <salida>" o "ERROR <mensaje>".
+ */
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Pedido recibido por el socket: un directorio o los archivos del caso en memoria
+struct PedidoReconstruccion {
+    std::string directorio;                         // CASO; vacío en un pedido INLINE
+    std::string imagen;                             // INLINE: contenido de I_D.bmp, I_M.bmp y M.bmp
+    std::string imask;
+    std::string mascara;
+    std::vector<std::string> enmascaramientos;      // INLINE: contenido de M0 ... M{n-1} (.txt o .bin)
+    std::string salida;                             // INLINE: ruta de la imagen reconstruida
+};
+
+// Límites de un pedido INLINE, para que un cliente no pueda pedir memoria sin control: la memoria de un pedido
+// crece a medida que llegan los bytes y nunca pasa de MAX_BYTES_PEDIDO entre todos sus archivos
+const size_t MAX_BYTES_ARCHIVO_PEDIDO = (size_t)512 << 20;
+const size_t MAX_BYTES_PEDIDO = (size_t)1 << 30;
+const size_t MAX_ETAPAS_PEDIDO = 1024;
+
+// Conexiones atendidas a la vez (un hilo cada una); las demás se rechazan con un ERROR
+const size_t MAX_CONEXIONES_SERVIDOR = 16;
+
+// Casos distintos cuyas métricas conserva el servidor; al pasarse se descarta el que lleva más tiempo sin pedirse
+const size_t MAX_CASOS_METRICAS_SERVIDOR = 256;
+
+// Reconstruye un pedido escribiendo el informe en 'informe'; devuelve false si no se pudo y deja la salida en 'archivoFinal'
+using AtenderPedido = std::function<bool(PedidoReconstruccion& pedido, std::ostream& informe, std::string& archivoFinal)>;
+
+// Escribe el estado del servidor (una línea por dato)
+using EstadoServidor = std::function<void(std::ostream& salida)>;
+
+int ejecutarServidor(const std::string& rutaSocket, const AtenderPedido& atender, const EstadoServidor& estado);
+
+#endif // SERVIDOR_H